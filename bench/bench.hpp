@@ -0,0 +1,112 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Host micro-benchmarks, a table on stderr and JSON on stdout:
+//   {"benchmarks": [{"name": ..., "ns": per call, "iterations": ...,
+//                    "allocs": per call, "mb_per_s": if bytes given}, ...]}
+// Compare two runs with tools/bench_compare.py.
+namespace bench {
+
+struct result {
+    std::string name;
+    double ns;
+    unsigned long iterations;
+    double allocs;
+    size_t bytes;
+};
+
+struct options {
+    double min_time = 0.5;      // s per benchmark
+    unsigned rounds = 5;
+    const char *filter = "";    // substring of the names to run
+};
+
+inline options opts;
+inline std::vector<result> results;
+
+// counted by the operator new in main.cpp
+inline unsigned long allocations = 0;
+
+// runs func() until min_time has passed, bytes: input size per call
+template<class Func>
+void run(const char *name, Func func, size_t bytes = 0) {
+    using clock = std::chrono::steady_clock;
+
+    if (!std::strstr(name, opts.filter))
+        return;
+
+    // warm up caches and lazily built tables
+    for (unsigned i = 0; i < 16; ++i)
+        func();
+
+    // the fastest of a few rounds, the others were interrupted more
+    double ns = 0;
+    unsigned long iterations = 0;
+    unsigned long allocs = allocations;
+
+    for (unsigned round = 0; round < opts.rounds; ++round) {
+        unsigned long count = 0;
+        auto start = clock::now();
+        std::chrono::duration<double> elapsed;
+
+        do {
+            for (unsigned i = 0; i < 64; ++i)
+                func();
+            count += 64;
+            elapsed = clock::now() - start;
+        } while (elapsed.count() < opts.min_time / opts.rounds);
+
+        double round_ns = elapsed.count() * 1e9 / count;
+        if (!round || round_ns < ns)
+            ns = round_ns;
+        iterations += count;
+    }
+
+    double allocs_per_call = double(allocations - allocs) / iterations;
+
+    std::fprintf(stderr, "%-32s %12.1f ns %8.2f allocs", name, ns, allocs_per_call);
+    if (bytes)
+        std::fprintf(stderr, " %10.1f MB/s", bytes / ns * 1e3);
+    std::fprintf(stderr, "\n");
+
+    results.push_back({name, ns, iterations, allocs_per_call, bytes});
+}
+
+// keeps the compiler from optimizing away a result
+template<class T>
+inline void do_not_optimize(T const& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+inline void parse_args(int argc, char **argv) {
+    for (int i = 1; i < argc; ++i) {
+        if (!std::strcmp(argv[i], "--min-time") && i + 1 < argc)
+            opts.min_time = std::atof(argv[++i]);
+        else if (!std::strcmp(argv[i], "--rounds") && i + 1 < argc)
+            opts.rounds = std::max(std::atoi(argv[++i]), 1);
+        else if (!std::strcmp(argv[i], "--filter") && i + 1 < argc)
+            opts.filter = argv[++i];
+    }
+}
+
+inline void print_json() {
+    std::printf("{\"benchmarks\": [\n");
+    for (size_t i = 0; i < results.size(); ++i) {
+        auto& r = results[i];
+        std::printf("  {\"name\": \"%s\", \"ns\": %.2f, \"iterations\": %lu, \"allocs\": %.2f",
+                    r.name.c_str(), r.ns, r.iterations, r.allocs);
+        if (r.bytes)
+            std::printf(", \"mb_per_s\": %.1f", r.bytes / r.ns * 1e3);
+        std::printf("}%s\n", i + 1 < results.size() ? "," : "");
+    }
+    std::printf("]}\n");
+}
+
+}
@@ -0,0 +1,447 @@
+#include <chrono>
+#include <cstdarg>
+#include <map>
+#include <new>
+
+#include <command_parser.hpp>
+#include <commands.hpp>
+#include <configbase.hpp>
+#include <crc.h>
+#include <effects.hpp>
+#include <output.hpp>
+#include <protocol.hpp>
+#include <render.hpp>
+#include <ringbuffer.h>
+#include <rpc.hpp>
+#include <serialprotocol.h>
+#include <trace.hpp>
+#include <ws2812.hpp>
+
+#include "bench.hpp"
+
+using bench::do_not_optimize;
+
+// espbase::trace stamps its entries
+uint32_t espbase::cycles() {
+    return std::chrono::steady_clock::now().time_since_epoch().count();
+}
+
+void *operator new(size_t size) {
+    bench::allocations++;
+    if (void *p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete(void *p, size_t) noexcept { std::free(p); }
+
+const unsigned NUM_LEDS = 60;
+
+
+// the firmware's calc_colors() without the clock and NTP lookups
+static void bench_render() {
+    static ledstrip::phase_lut lut;
+    static ledstrip::gamma_lut gamma;
+    static ledstrip::color_ramp ramp;
+    static uint16_t colors[NUM_LEDS][3];
+
+    gamma.build(255, 2.2f);
+
+    ledstrip::render_input in = {
+        .t_ms = 0,
+        .max_progression = 0xffff,
+        .animation_speed = 0x0100,
+        .duration = 90 * 60,
+        .variation = 0x0100,
+        .led_count = NUM_LEDS,
+    };
+
+    for (unsigned effect = 0; effect < ledstrip::effect_count; ++effect) {
+        std::string name = std::string("calc_colors/") + ledstrip::effect_name(effect);
+
+        bench::run(name.c_str(), [&]{
+            in.t_ms = (in.t_ms + 2500) % (in.duration * 1000u);
+            ledstrip::render(effect, ledstrip::prepare(in, ramp), lut, gamma, colors);
+            do_not_optimize(colors);
+        });
+    }
+}
+
+
+// what update_strip() sends, encoded in loop()
+static void bench_encode() {
+    static ledstrip::ws2812::encoder<NUM_LEDS> encoder;
+    static ledstrip::ws2812::bitstream<NUM_LEDS> frame;
+    static uint16_t colors[NUM_LEDS][3];
+
+    for (unsigned i = 0; i < NUM_LEDS; ++i)
+        for (unsigned j = 0; j < 3; ++j)
+            colors[i][j] = (i * 0x0455 + j * 0x1234) & 0xffff;
+
+    bench::run("encode/bitbang", []{
+        encoder.encode(colors, 0, ledstrip::ws2812::format::bitbang, frame);
+        do_not_optimize(frame);
+    });
+
+    bench::run("encode/bitbang_dither", []{
+        encoder.encode(colors, 0xff, ledstrip::ws2812::format::bitbang, frame);
+        do_not_optimize(frame);
+    });
+
+    bench::run("encode/uart", []{
+        encoder.encode(colors, 0, ledstrip::ws2812::format::uart, frame);
+        do_not_optimize(frame);
+    });
+}
+
+
+// commands as they arrive over serial and TCP
+static void bench_protocol() {
+    static const char *const corpus[] = {
+        "d\n",
+        "on\n",
+        "t0 120\n",
+        "config led_brightness 0xff\n",
+        "config hostname 'wake-up light'\n",
+        "config ramp 0x00000000000000006666ffff66663333"
+        "8000ffff80004000ffffffffffffffff\n",
+        "config alarms 0x1e007f00\n",
+        "perf calc_colors\n",
+    };
+
+    static protocol p;
+    static unsigned commands;
+    p.command_callback = [](std::vector<char>&& command, std::vector<std::vector<char>>&& args) {
+        commands += command.size() + args.size();
+    };
+
+    std::vector<char> all;
+    for (auto *c : corpus)
+        all.insert(all.end(), c, c + std::strlen(c));
+
+    // parse() consumes the read buffer, a new one per read
+    bench::run("protocol/parse_corpus", [&]{
+        p.parse(std::vector<char>(all));
+        do_not_optimize(commands);
+    }, all.size());
+
+    bench::run("protocol/parse_short", []{
+        p.parse(std::vector<char>(corpus[0], corpus[0] + 2));
+        do_not_optimize(commands);
+    }, 2);
+
+    static espbase::command_parser parser;
+    parser.on_command = [](std::string_view command, espbase::command_parser::arguments const& args) {
+        commands += command.size() + args.size();
+    };
+
+    bench::run("command_parser/parse_corpus", [&]{
+        parser.parse(all.data(), all.size());
+        do_not_optimize(commands);
+    }, all.size());
+
+    // serial delivers a few bytes at a time, open commands go to the arena
+    bench::run("command_parser/split_reads", [&]{
+        for (size_t i = 0; i < all.size(); i += 16)
+            parser.parse(all.data() + i, std::min<size_t>(16, all.size() - i));
+        do_not_optimize(commands);
+    }, all.size());
+
+    bench::run("command_parser/parse_short", []{
+        parser.parse(corpus[0], 2);
+        do_not_optimize(commands);
+    }, 2);
+}
+
+
+// command lookup and call, the firmware's names
+static const char *const command_names[] = {
+    "alarms", "commands", "commit", "config", "d", "d3_hi", "d3_lo", "device-name",
+    "disable-timer", "effects", "enable-timer", "off", "on", "perf", "perf-reset", "ramp",
+    "reset-config", "restart", "t0", "tasks", "tasks-reset", "time", "timer", "trace",
+    "wifi", "wifi-scan", "wifi-start",
+};
+
+static unsigned command_runs;
+
+template<size_t... I>
+static constexpr auto make_commands(std::index_sequence<I...>) {
+    return espbase::sorted_commands({espbase::command{command_names[I], [](auto&){ command_runs++; }}...});
+}
+
+static void bench_commands() {
+    const size_t count = std::size(command_names);
+
+    // as registered before: every no-argument handler wrapped once more
+    using handler = std::function<void(std::vector<std::vector<char>>&&)>;
+    auto build_map = [&]{
+        std::map<std::string, handler> map;
+        for (auto *name : command_names) {
+            std::function<void()> callback = []{ command_runs++; };
+            map[name] = [callback](std::vector<std::vector<char>>&&){ callback(); };
+        }
+        return map;
+    };
+
+    static auto map = build_map();
+    bench::run("commands/map_build", [&]{ do_not_optimize(build_map()); });
+
+    static size_t i;
+    bench::run("commands/map_dispatch", [&]{
+        std::string_view name = command_names[i++ % count];
+        auto itr = map.find(std::string(name));
+        itr->second({});
+    });
+
+    static const auto table = make_commands(std::make_index_sequence<std::size(command_names)>());
+    static const espbase::command_table commands(table);
+    static const espbase::command_args no_args;
+
+    bench::run("commands/table_dispatch", [&]{
+        std::string_view name = command_names[i++ % count];
+        (*commands.find(name))(no_args);
+    });
+}
+
+
+static void bench_crc() {
+    static char data[256];
+    for (unsigned i = 0; i < sizeof(data); ++i)
+        data[i] = i * 37;
+
+    bench::run("crc16/31", []{ do_not_optimize(crc16(data, Packet::size - 2)); });
+    bench::run("crc16/256", []{ do_not_optimize(crc16(data, sizeof(data))); });
+}
+
+
+static void bench_ring_buffer() {
+    static ring_buffer<uint32_t> ring(512);
+
+    bench::run("ring_buffer/push_pop", []{
+        ring.push_back(ring.size());
+        if (ring.size() > 256)
+            ring.pop_front();
+        do_not_optimize(ring.front());
+    });
+
+    bench::run("ring_buffer/push_full", []{
+        ring.push_back(ring.size());
+        do_not_optimize(ring.back());
+    });
+
+    static espbase::trace trace(512);
+    bench::run("trace/record", []{ trace.record(espbase::trace_user, 1); });
+}
+
+
+static espbase::config_base::meta config_meta;
+struct bench_config : espbase::config_base {
+    member<uint8_t>     led_brightness  = {&config_meta, "led_brightness",  255};
+    member<uint16_t>    animation_speed = {&config_meta, "animation_speed", 0x0100};
+    member<uint8_t>     led_irq_window  = {&config_meta, "led_irq_window",  0};
+    member<char[32]>    hostname        = {&config_meta, "hostname",        {}};
+    member<uint16_t[32]> ramp           = {&config_meta, "ramp",            ledstrip::color_ramp::default_keyframes};
+    member<uint32_t[8]> alarms          = {&config_meta, "alarms",          {0x1e00, 0x7f0005a0}};
+};
+
+static void bench_config_meta() {
+    static bench_config config;
+    static char buf[64];
+
+    config_meta.on_change("ramp", []{ });
+
+    bench::run("config/get_u8", []{
+        config_meta.get("led_brightness", buf);
+        do_not_optimize(buf);
+    });
+
+    bench::run("config/set_u8", []{
+        buf[0]++;
+        config_meta.set("led_brightness", buf);
+        do_not_optimize(config.led_brightness.value);
+    });
+
+    bench::run("config/get_ramp", []{
+        config_meta.get("ramp", buf);
+        do_not_optimize(buf);
+    });
+
+    bench::run("config/set_ramp", []{
+        config_meta.set("ramp", buf);
+        do_not_optimize(config.ramp.value);
+    });
+}
+
+
+// the config listing as the TCP client sees it, writes ~ segments
+struct counting_sink : Print {
+    unsigned long writes = 0, flushes = 0;
+
+    size_t write(uint8_t) override { writes++; return 1; }
+    size_t write(const uint8_t *, size_t size) override { writes++; return size; }
+    using Print::write;
+    void flush() override { flushes++; }
+};
+
+static counting_sink sink;
+
+// espbase::print before the output buffer
+static int print_unbuffered(const char *format, ...) {
+    std::va_list argp, argc;
+    va_start(argp, format);
+    va_copy(argc, argp);
+    int size = std::vsnprintf(nullptr, 0, format, argc);
+    va_end(argc);
+
+    std::vector<char> print_buffer;
+    if (size > 0) {
+        print_buffer.resize(size + 1);
+        size = std::vsnprintf(print_buffer.data(), std::size_t(size) + 1, format, argp);
+        print_buffer.resize(size);
+    }
+    va_end(argp);
+
+    sink.write(print_buffer.data(), print_buffer.size());
+    sink.flush();
+    return size;
+}
+
+static void bench_output() {
+    static char value[64];
+
+    auto report = [](const char *name, unsigned long calls) {
+        if (calls && std::strstr(name, bench::opts.filter))
+            std::fprintf(stderr, "    %.1f writes, %.1f flushes per command\n",
+                         double(sink.writes) / calls, double(sink.flushes) / calls);
+        sink = {};
+    };
+
+    unsigned long calls = 0;
+    bench::run("output/config_unbuffered", [&]{
+        print_unbuffered("command: %s\n", "config");
+        for (auto const& m : config_meta.members()) {
+            size_t size = m.second->type_info->size;
+            m.second->get(value);
+            print_unbuffered("config %s ", m.first.c_str());
+            print_unbuffered("0x");
+            for (size_t i = 0; i < size; ++i)
+                print_unbuffered("%c%c", espbase::to_hex(uint8_t(value[i]) >> 4), espbase::to_hex(value[i] & 0xf));
+            print_unbuffered("\n");
+        }
+        print_unbuffered("\n");
+        calls++;
+    });
+    report("output/config_unbuffered", calls);
+
+    static espbase::output out;
+    out.sink(&sink);
+
+    calls = 0;
+    bench::run("output/config_buffered", [&]{
+        out.printf("command: %s\n", "config");
+        for (auto const& m : config_meta.members()) {
+            size_t size = m.second->type_info->size;
+            m.second->get(value);
+            out.printf("config %s ", m.first.c_str());
+            out.print("0x");
+            for (size_t i = 0; i < size; ++i) {
+                char *hex = out.reserve(2);
+                hex[0] = espbase::to_hex(uint8_t(value[i]) >> 4);
+                hex[1] = espbase::to_hex(value[i] & 0xf);
+                out.commit(2);
+            }
+            out.write('\n');
+        }
+        out.write('\n');
+        out.flush();
+        calls++;
+    });
+    report("output/config_buffered", calls);
+}
+
+
+// a binary get of the whole config and its set back, framed as by tools/rpc.py
+static void bench_rpc() {
+    static espbase::rpc rpc;
+    static std::vector<char> request, get_reply;
+    static size_t replied;
+
+    auto frame = [](uint8_t opcode, std::vector<char> const& payload) {
+        std::vector<char> f = {char(espbase::rpc::magic), char(payload.size() + 1), char((payload.size() + 1) >> 8), char(opcode)};
+        f.insert(f.end(), payload.begin(), payload.end());
+        uint16_t crc = crc16(f.data() + 1, f.size() - 1);
+        f.push_back(crc);
+        f.push_back(crc >> 8);
+        return f;
+    };
+
+    rpc.meta = &config_meta;
+    rpc.on_reply = [](const char *data, size_t size) {
+        get_reply.assign(data, data + size);
+        replied += size;
+    };
+
+    request = frame(espbase::rpc::op_get, {});
+    bench::run("rpc/get_all", []{
+        rpc.parse(request.data(), request.size());
+        do_not_optimize(replied);
+    });
+
+    // the get reply's entries are a set request
+    request = frame(espbase::rpc::op_set, std::vector<char>(get_reply.begin() + 4, get_reply.end() - 2));
+    bench::run("rpc/set_all", []{
+        rpc.parse(request.data(), request.size());
+        do_not_optimize(replied);
+    }, request.size());
+}
+
+
+// a sample through the ECG serial link: packet, CRC, parse, reorder
+static void bench_serial_protocol() {
+    static SerialProtocol tx, rx;
+    static unsigned arrived;
+
+    rx.setReorderBufferSize(32);
+    rx.onPacketArrived = [](Packet const&) { arrived++; };
+    tx.onPacketReady = [](Packet const& packet) { rx.parseBuffer(std::vector<char>(packet.buffer)); };
+
+    bench::run("serial_protocol/round_trip", []{
+        auto *sample = tx.beginSample();
+        for (char s = 0; s < Packet::channels * Packet::precision; ++s)
+            *sample++ = s;
+        do_not_optimize(arrived);
+    });
+
+    static SerialProtocol reorder_tx, reorder_rx;
+    reorder_tx.setTransmitOrder(2);
+    reorder_rx.setReorderBufferSize(32);
+    reorder_rx.onPacketArrived = [](Packet const&) { arrived++; };
+    reorder_tx.onPacketReady = [](Packet const& packet) { reorder_rx.parseBuffer(std::vector<char>(packet.buffer)); };
+
+    bench::run("serial_protocol/reordered", []{
+        auto *sample = reorder_tx.beginSample();
+        for (char s = 0; s < Packet::channels * Packet::precision; ++s)
+            *sample++ = s;
+        do_not_optimize(arrived);
+    });
+}
+
+
+int main(int argc, char **argv) {
+    bench::parse_args(argc, argv);
+
+    bench_render();
+    bench_encode();
+    bench_protocol();
+    bench_commands();
+    bench_crc();
+    bench_ring_buffer();
+    bench_config_meta();
+    bench_output();
+    bench_rpc();
+    bench_serial_protocol();
+
+    bench::print_json();
+    return 0;
+}
@@ -0,0 +1,180 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <new>
+#include <string>
+
+#include "hal.h"
+
+#define IRAM_ATTR
+#define ICACHE_RAM_ATTR
+#define PROGMEM
+
+#define PI 3.1415926535897932384626433832795
+
+typedef bool boolean;
+typedef uint8_t byte;
+typedef unsigned long ulong;
+
+using std::min;
+using std::max;
+using std::round;
+
+enum { LOW = 0, HIGH = 1 };
+enum { INPUT = 0, OUTPUT = 1 };
+
+static const uint8_t D3 = 0;
+static const uint8_t D4 = 2;
+static const uint8_t LED_BUILTIN = 2;
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+void tone(uint8_t pin, unsigned frequency, unsigned long duration = 0);
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void yield();
+
+#define GPOS hal::gpos
+#define GPOC hal::gpoc
+
+#define TIM_DIV1    0
+#define TIM_DIV16   1
+#define TIM_DIV256  3
+#define TIM_EDGE    0
+#define TIM_LEVEL   1
+#define TIM_SINGLE  0
+#define TIM_LOOP    1
+
+#define T1L hal::timer1_load()
+#define T1V hal::timer1_value()
+#define T1I hal::timer1_int
+
+#define ETS_FRC_TIMER1_INTR_ATTACH(func, arg) hal::timer1_attach(func, arg)
+#define ETS_FRC1_INTR_ENABLE()
+#define ETS_INTR_LOCK()
+#define ETS_INTR_UNLOCK()
+
+inline void timer1_write(uint32_t ticks) { hal::timer1_write(ticks); }
+inline void timer1_enable(uint8_t div, uint8_t edge, uint8_t reload) { hal::timer1_enable(div, edge, reload); }
+inline void timer1_disable() { hal::timer1_disable(); }
+
+#define STREAM_READ_RETURNS_INT 1
+
+
+class String {
+public:
+    String() = default;
+    String(const char *str): m_str(str ? str : "") { }
+    String(std::string&& str): m_str(std::move(str)) { }
+
+    inline const char *c_str() const { return m_str.c_str(); }
+    inline unsigned length() const { return m_str.size(); }
+
+    inline String operator+(String const& other) const { return m_str + other.m_str; }
+    inline bool operator==(const char *other) const { return m_str == other; }
+
+private:
+    std::string m_str;
+};
+
+inline String operator+(const char *lhs, String const& rhs) { return String(lhs) + rhs; }
+
+
+class Print {
+public:
+    virtual ~Print() = default;
+
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t *buffer, size_t size) {
+        size_t n = 0;
+        while (size--)
+            n += write(*buffer++);
+        return n;
+    }
+    inline size_t write(const char *buffer, size_t size) {
+        return write(reinterpret_cast<const uint8_t *>(buffer), size); }
+    virtual void flush() { }
+
+    size_t printf(const char *format, ...) __attribute__((format(printf, 2, 3)));
+
+    inline size_t print(const char *str) { return write(str, std::strlen(str)); }
+    inline size_t print(String const& str) { return print(str.c_str()); }
+    inline size_t print(char c) { return write(uint8_t(c)); }
+    inline size_t print(int n) { return printf("%d", n); }
+    inline size_t print(unsigned n) { return printf("%u", n); }
+
+    inline size_t println() { return print("\r\n"); }
+    template<class T>
+    inline size_t println(T const& value) { return print(value) + println(); }
+};
+
+class Stream : public Print {
+public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+    virtual size_t read(char *buffer, size_t size) {
+        size_t n = 0;
+        for (int c; n < size && (c = read()) >= 0; ++n)
+            buffer[n] = c;
+        return n;
+    }
+    inline size_t read(uint8_t *buffer, size_t size) {
+        return read(reinterpret_cast<char *>(buffer), size); }
+};
+
+
+enum SerialConfig { SERIAL_8N1, SERIAL_6N1 };
+enum SerialMode { SERIAL_FULL, SERIAL_RX_ONLY, SERIAL_TX_ONLY };
+
+// Serial reads stdin and writes stdout, Serial1 discards its output
+class HardwareSerial : public Stream {
+public:
+    constexpr HardwareSerial(int uart): m_uart(uart) { }
+
+    void begin(unsigned long baud) { }
+    void begin(unsigned long baud, SerialConfig config, SerialMode mode,
+               uint8_t tx_pin = 1, bool invert = false) { }
+    void end() { }
+
+    int available() override;
+    int read() override;
+    int peek() override;
+    using Stream::read;
+    size_t read(char *buffer, size_t size) override;
+
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t *buffer, size_t size) override;
+    using Print::write;
+    void flush() override;
+
+private:
+    int m_uart;
+};
+
+extern HardwareSerial Serial;
+extern HardwareSerial Serial1;
+
+
+class EspClass {
+public:
+    inline uint32_t getCycleCount() { return hal::cycles(); }
+    void getHeapStats(uint32_t *free, uint16_t *max, uint8_t *frag);
+    String getResetInfo();
+    [[noreturn]] void restart();
+};
+
+extern EspClass ESP;
+
+void setup();
+void loop();
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <Arduino.h>
+
+#define U_FLASH   0
+#define U_FS      100
+#define U_SPIFFS  U_FS
+
+typedef enum {
+    OTA_AUTH_ERROR,
+    OTA_BEGIN_ERROR,
+    OTA_CONNECT_ERROR,
+    OTA_RECEIVE_ERROR,
+    OTA_END_ERROR
+} ota_error_t;
+
+class ArduinoOTAClass {
+public:
+    inline void setPort(uint16_t port) { }
+    inline void begin() { }
+    inline void handle() { }
+    inline int getCommand() { return U_FLASH; }
+
+    inline void onStart(std::function<void()> fn) { }
+    inline void onEnd(std::function<void()> fn) { }
+    inline void onProgress(std::function<void(unsigned, unsigned)> fn) { }
+    inline void onError(std::function<void(ota_error_t)> fn) { }
+};
+
+extern ArduinoOTAClass ArduinoOTA;
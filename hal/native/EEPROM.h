@@ -0,0 +1,19 @@
+#pragma once
+
+#include <Arduino.h>
+
+// backed by memory, loaded from and committed to eeprom.bin
+// trivially constructible: the firmware calls begin() during static init
+class EEPROMClass {
+public:
+    void begin(size_t size);
+    bool commit();
+    inline uint8_t *getDataPtr() { return m_data; }
+    inline size_t length() const { return m_size; }
+
+private:
+    uint8_t m_data[4096];
+    size_t m_size;
+};
+
+extern EEPROMClass EEPROM;
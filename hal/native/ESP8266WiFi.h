@@ -0,0 +1,43 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "IPAddress.h"
+#include "WiFiClient.h"
+#include "WiFiServer.h"
+
+typedef enum WiFiMode {
+    WIFI_OFF = 0, WIFI_STA = 1, WIFI_AP = 2, WIFI_AP_STA = 3
+} WiFiMode_t;
+
+enum wl_enc_type {
+    ENC_TYPE_WEP  = 5,
+    ENC_TYPE_TKIP = 2,
+    ENC_TYPE_CCMP = 4,
+    ENC_TYPE_NONE = 7,
+    ENC_TYPE_AUTO = 8
+};
+
+// no network on the host, the station never connects
+class ESP8266WiFiClass {
+public:
+    inline bool mode(WiFiMode_t mode) { m_mode = mode; return true; }
+    inline void begin(const char *ssid, const char *password) { }
+    inline bool softAPConfig(IPAddress local, IPAddress gateway, IPAddress subnet) { return true; }
+    inline bool softAP(const char *ssid, const char *password) { return true; }
+    inline bool isConnected() { return false; }
+    inline IPAddress localIP() { return {}; }
+
+    uint8_t *macAddress(uint8_t *mac);
+    String macAddress();
+
+    inline int8_t scanNetworks() { return 0; }
+    inline int32_t RSSI(uint8_t i) { return 0; }
+    inline uint8_t encryptionType(uint8_t i) { return ENC_TYPE_NONE; }
+    inline String SSID(uint8_t i) { return {}; }
+
+private:
+    WiFiMode_t m_mode = WIFI_OFF;
+};
+
+extern ESP8266WiFiClass WiFi;
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <Arduino.h>
+
+class IPAddress {
+public:
+    IPAddress(uint32_t addr = 0): m_addr(addr) { }
+    String toString() const;
+
+private:
+    uint32_t m_addr;
+};
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <memory>
+
+#include <Arduino.h>
+
+#include "IPAddress.h"
+
+// A loopback TCP connection, see WiFiServer. Copies share the socket like
+// the ESP8266 ones share their context, stop() closes it for all of them.
+class WiFiClient : public Stream {
+public:
+    WiFiClient() = default;
+    explicit WiFiClient(int fd);
+
+    uint8_t connected();
+    void stop();
+    void keepAlive(uint16_t idle_s = 7200, uint16_t interval_s = 75, uint8_t count = 9);
+
+    IPAddress remoteIP() const;
+    uint16_t remotePort() const;
+
+    int available() override;
+    int read() override;
+    int peek() override;
+    using Stream::read;
+    size_t read(char *buffer, size_t size) override;
+
+    inline size_t write(uint8_t c) override { return write(&c, 1); }
+    size_t write(const uint8_t *buffer, size_t size) override;
+    using Print::write;
+
+private:
+    struct socket {
+        int fd;
+        ~socket();
+    };
+
+    std::shared_ptr<socket> m_socket;
+};
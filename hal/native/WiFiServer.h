@@ -0,0 +1,19 @@
+#pragma once
+
+#include "WiFiClient.h"
+
+// Listens on 127.0.0.1, so tools can talk to the host build like to the
+// light. Without a free port it quietly has no clients.
+class WiFiServer {
+public:
+    WiFiServer(uint16_t port): m_port(port) { }
+    ~WiFiServer();
+
+    void begin(uint16_t port = 0);
+    bool hasClient();
+    WiFiClient available();
+
+private:
+    uint16_t m_port;
+    int m_fd = -1;
+};
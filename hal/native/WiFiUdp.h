@@ -0,0 +1,79 @@
+#pragma once
+
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <vector>
+
+#include <Arduino.h>
+
+#include "IPAddress.h"
+
+// Loopback stand-in: requests to port 123 are answered right away by a
+// local SNTP responder with the host time, everything else is dropped.
+class WiFiUDP {
+public:
+    inline uint8_t begin(uint16_t port) { return 1; }
+    inline void stop() { m_replies.clear(); }
+
+    inline int beginPacket(const char *host, uint16_t port) {
+        m_out.clear();
+        m_port = port;
+        return 1;
+    }
+
+    inline int beginPacket(IPAddress ip, uint16_t port) { return beginPacket("", port); }
+
+    inline size_t write(const uint8_t *data, size_t size) {
+        auto start = m_out.size();
+        m_out.resize(start + size);
+        std::memcpy(m_out.data() + start, data, size);
+        return size;
+    }
+
+    inline int endPacket() {
+        if (m_port == 123 && m_out.size() >= 48)
+            m_replies.push_back(sntp_reply());
+        return 1;
+    }
+
+    inline int parsePacket() {
+        if (m_replies.empty())
+            return 0;
+        m_in = std::move(m_replies.front());
+        m_replies.pop_front();
+        return m_in.size();
+    }
+
+    inline int read(uint8_t *data, size_t size) {
+        size = std::min(size, m_in.size());
+        std::memcpy(data, m_in.data(), size);
+        return size;
+    }
+
+private:
+    std::vector<uint8_t> sntp_reply() const {
+        using namespace std::chrono;
+        auto us = duration_cast<microseconds>(system_clock::now().time_since_epoch()).count();
+
+        uint32_t secs = us / 1000000 + 2208988800u;
+        uint32_t frac = (uint64_t(us % 1000000) << 32) / 1000000;
+
+        std::vector<uint8_t> reply(48, 0);
+        reply[0] = 0x24;    // version 4, mode 4 (server)
+        reply[1] = 1;       // stratum
+        std::memcpy(&reply[24], &m_out[40], 8);
+
+        for (unsigned i = 0; i < 4; ++i) {
+            reply[40 + i] = secs >> (24 - 8 * i);
+            reply[44 + i] = frac >> (24 - 8 * i);
+        }
+
+        return reply;
+    }
+
+    std::vector<uint8_t> m_out;
+    std::vector<uint8_t> m_in;
+    std::deque<std::vector<uint8_t>> m_replies;
+    uint16_t m_port = 0;
+};
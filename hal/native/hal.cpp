@@ -0,0 +1,384 @@
+#include <cerrno>
+#include <chrono>
+#include <fstream>
+#include <thread>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <Arduino.h>
+#include <ArduinoOTA.h>
+#include <EEPROM.h>
+#include <ESP8266WiFi.h>
+
+HardwareSerial Serial(0);
+HardwareSerial Serial1(1);
+EspClass ESP;
+EEPROMClass EEPROM;
+ESP8266WiFiClass WiFi;
+ArduinoOTAClass ArduinoOTA;
+
+bool hal::quit = false;
+bool hal::trace_gpio = false;
+std::vector<hal::gpio_edge> hal::gpio_trace;
+hal::gpio_reg hal::gpos = {true};
+hal::gpio_reg hal::gpoc = {false};
+volatile uint32_t hal::timer1_int;
+
+static const char *eeprom_file = "eeprom.bin";
+
+static uint32_t s_cycle_offset;
+
+static std::chrono::steady_clock::time_point start_time() {
+    static const auto start = std::chrono::steady_clock::now();
+    return start;
+}
+
+static struct {
+    hal::isr_t isr;
+    void *arg;
+    uint32_t ticks;
+    uint32_t last;
+    bool enabled;
+} s_timer1;
+
+
+uint32_t hal::cycles() {
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start_time()).count();
+    return uint32_t(uint64_t(ns) * (F_CPU / 1000000) / 1000) + s_cycle_offset;
+}
+
+void hal::advance_cycles(uint32_t n) {
+    s_cycle_offset += n;
+}
+
+
+void hal::timer1_attach(isr_t isr, void *arg) {
+    s_timer1.isr = isr;
+    s_timer1.arg = arg;
+}
+
+void hal::timer1_write(uint32_t ticks) {
+    s_timer1.ticks = ticks;
+    s_timer1.last = cycles();
+}
+
+void hal::timer1_enable(uint8_t div, uint8_t edge, uint8_t reload) {
+    s_timer1.enabled = true;
+    s_timer1.last = cycles();
+}
+
+void hal::timer1_disable() {
+    s_timer1.enabled = false;
+}
+
+bool hal::timer1_enabled() {
+    return s_timer1.enabled;
+}
+
+uint32_t hal::timer1_load() {
+    return s_timer1.ticks;
+}
+
+uint32_t hal::timer1_value() {
+    uint32_t elapsed = cycles() - s_timer1.last;
+    return elapsed < s_timer1.ticks ? s_timer1.ticks - elapsed : 0;
+}
+
+void hal::run_timer() {
+    if (!s_timer1.enabled || !s_timer1.isr || !s_timer1.ticks)
+        return;
+
+    uint32_t now = cycles();
+    if (now - s_timer1.last < s_timer1.ticks)
+        return;
+
+    s_timer1.last = now;
+    s_timer1.isr(s_timer1.arg, nullptr);
+}
+
+
+void pinMode(uint8_t pin, uint8_t mode) { }
+void digitalWrite(uint8_t pin, uint8_t value) { }
+int digitalRead(uint8_t pin) { return HIGH; }
+void tone(uint8_t pin, unsigned frequency, unsigned long duration) { }
+
+unsigned long millis() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start_time()).count();
+}
+
+unsigned long micros() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start_time()).count();
+}
+
+void delay(unsigned long ms) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+void yield() { }
+
+
+size_t Print::printf(const char *format, ...) {
+    char buf[256];
+    std::va_list argp;
+    va_start(argp, format);
+    int size = std::vsnprintf(buf, sizeof(buf), format, argp);
+    va_end(argp);
+
+    if (size < 0)
+        return 0;
+    return write(buf, std::min<size_t>(size, sizeof(buf) - 1));
+}
+
+
+int HardwareSerial::available() {
+    if (m_uart != 0)
+        return 0;
+
+    pollfd fd = {STDIN_FILENO, POLLIN, 0};
+    if (poll(&fd, 1, 0) <= 0)
+        return 0;
+    if (fd.revents & POLLHUP && !(fd.revents & POLLIN))
+        hal::quit = true;
+    return (fd.revents & POLLIN) ? 1 : 0;
+}
+
+int HardwareSerial::read() {
+    char c;
+    return read(&c, 1) == 1 ? uint8_t(c) : -1;
+}
+
+int HardwareSerial::peek() {
+    return -1;
+}
+
+size_t HardwareSerial::read(char *buffer, size_t size) {
+    if (m_uart != 0)
+        return 0;
+
+    ssize_t n = ::read(STDIN_FILENO, buffer, size);
+    if (n <= 0) {
+        hal::quit = true;
+        return 0;
+    }
+    return n;
+}
+
+size_t HardwareSerial::write(uint8_t c) {
+    return write(&c, 1);
+}
+
+size_t HardwareSerial::write(const uint8_t *buffer, size_t size) {
+    if (m_uart != 0)
+        return size;
+
+    return std::fwrite(buffer, 1, size, stdout);
+}
+
+void HardwareSerial::flush() {
+    std::fflush(stdout);
+}
+
+
+void EspClass::getHeapStats(uint32_t *free, uint16_t *max, uint8_t *frag) {
+    *free = 0;
+    *max = 0;
+    *frag = 0;
+}
+
+String EspClass::getResetInfo() {
+    return "native";
+}
+
+void EspClass::restart() {
+    std::exit(0);
+}
+
+
+void EEPROMClass::begin(size_t size) {
+    m_size = std::min(size, sizeof(m_data));
+    std::memset(m_data, 0xff, m_size);
+
+    std::ifstream file(eeprom_file, std::ios::binary);
+    file.read(reinterpret_cast<char *>(m_data), m_size);
+}
+
+bool EEPROMClass::commit() {
+    std::ofstream file(eeprom_file, std::ios::binary);
+    file.write(reinterpret_cast<const char *>(m_data), m_size);
+    return bool(file);
+}
+
+
+String IPAddress::toString() const {
+    char buf[16];
+    std::snprintf(buf, sizeof(buf), "%u.%u.%u.%u",
+                  m_addr & 0xff, m_addr >> 8 & 0xff, m_addr >> 16 & 0xff, m_addr >> 24);
+    return buf;
+}
+
+WiFiClient::WiFiClient(int fd): m_socket(new socket{fd}) { }
+
+WiFiClient::socket::~socket() {
+    if (fd >= 0)
+        ::close(fd);
+}
+
+uint8_t WiFiClient::connected() {
+    if (!m_socket || m_socket->fd < 0)
+        return false;
+
+    // like on the ESP8266, still connected while there is data to read
+    char c;
+    ssize_t n = ::recv(m_socket->fd, &c, 1, MSG_PEEK | MSG_DONTWAIT);
+    if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+        stop();
+        return false;
+    }
+    return true;
+}
+
+void WiFiClient::stop() {
+    if (m_socket && m_socket->fd >= 0) {
+        ::close(m_socket->fd);
+        m_socket->fd = -1;
+    }
+    m_socket.reset();
+}
+
+void WiFiClient::keepAlive(uint16_t idle_s, uint16_t interval_s, uint8_t count) {
+    if (!m_socket || m_socket->fd < 0)
+        return;
+
+    int on = 1, idle = idle_s, interval = interval_s, probes = count;
+    ::setsockopt(m_socket->fd, SOL_SOCKET, SO_KEEPALIVE, &on, sizeof(on));
+    ::setsockopt(m_socket->fd, IPPROTO_TCP, TCP_KEEPIDLE, &idle, sizeof(idle));
+    ::setsockopt(m_socket->fd, IPPROTO_TCP, TCP_KEEPINTVL, &interval, sizeof(interval));
+    ::setsockopt(m_socket->fd, IPPROTO_TCP, TCP_KEEPCNT, &probes, sizeof(probes));
+}
+
+IPAddress WiFiClient::remoteIP() const {
+    sockaddr_in addr = {};
+    socklen_t size = sizeof(addr);
+    if (!m_socket || ::getpeername(m_socket->fd, reinterpret_cast<sockaddr *>(&addr), &size) < 0)
+        return {};
+    return addr.sin_addr.s_addr;
+}
+
+uint16_t WiFiClient::remotePort() const {
+    sockaddr_in addr = {};
+    socklen_t size = sizeof(addr);
+    if (!m_socket || ::getpeername(m_socket->fd, reinterpret_cast<sockaddr *>(&addr), &size) < 0)
+        return 0;
+    return ntohs(addr.sin_port);
+}
+
+int WiFiClient::available() {
+    int n = 0;
+    if (!m_socket || m_socket->fd < 0 || ::ioctl(m_socket->fd, FIONREAD, &n) < 0)
+        return 0;
+    return n;
+}
+
+int WiFiClient::read() {
+    char c;
+    return read(&c, 1) == 1 ? uint8_t(c) : -1;
+}
+
+int WiFiClient::peek() {
+    char c;
+    if (!m_socket || ::recv(m_socket->fd, &c, 1, MSG_PEEK | MSG_DONTWAIT) != 1)
+        return -1;
+    return uint8_t(c);
+}
+
+size_t WiFiClient::read(char *buffer, size_t size) {
+    if (!m_socket)
+        return 0;
+    ssize_t n = ::recv(m_socket->fd, buffer, size, MSG_DONTWAIT);
+    return n > 0 ? n : 0;
+}
+
+size_t WiFiClient::write(const uint8_t *buffer, size_t size) {
+    if (!m_socket)
+        return 0;
+    ssize_t n = ::send(m_socket->fd, buffer, size, MSG_NOSIGNAL);
+    return n > 0 ? n : 0;
+}
+
+
+WiFiServer::~WiFiServer() {
+    if (m_fd >= 0)
+        ::close(m_fd);
+}
+
+void WiFiServer::begin(uint16_t port) {
+    if (port)
+        m_port = port;
+
+    m_fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    int on = 1;
+    ::setsockopt(m_fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(m_port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    if (::bind(m_fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0 || ::listen(m_fd, 4) < 0) {
+        ::close(m_fd);
+        m_fd = -1;
+        return;
+    }
+    ::fcntl(m_fd, F_SETFL, O_NONBLOCK);
+}
+
+bool WiFiServer::hasClient() {
+    pollfd fd = {m_fd, POLLIN, 0};
+    return m_fd >= 0 && ::poll(&fd, 1, 0) > 0;
+}
+
+WiFiClient WiFiServer::available() {
+    int fd = m_fd >= 0 ? ::accept(m_fd, nullptr, nullptr) : -1;
+    return fd >= 0 ? WiFiClient(fd) : WiFiClient();
+}
+
+
+uint8_t *ESP8266WiFiClass::macAddress(uint8_t *mac) {
+    static const uint8_t host_mac[6] = {0x02, 0x00, 0x00, 0x00, 0x82, 0x66};
+    std::memcpy(mac, host_mac, sizeof(host_mac));
+    return mac;
+}
+
+String ESP8266WiFiClass::macAddress() {
+    uint8_t mac[6];
+    macAddress(mac);
+
+    char buf[18];
+    std::snprintf(buf, sizeof(buf), "%02X:%02X:%02X:%02X:%02X:%02X",
+                  mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+    return buf;
+}
+
+
+// runs until stdin is closed, the timer fires between loop() calls
+__attribute__((weak)) int main() {
+    setup();
+
+    while (!hal::quit) {
+        loop();
+        hal::run_timer();
+    }
+
+    std::fflush(stdout);
+    return 0;
+}
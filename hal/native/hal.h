@@ -0,0 +1,61 @@
+#pragma once
+
+// Host-side stand-ins for the ESP8266 hardware used by the firmware.
+//
+// The cycle counter is host time scaled to F_CPU, plus whatever a test adds
+// with advance_cycles(). Busy-wait loops on ccount therefore take real time,
+// and cycle measurements are "80 MHz cycles at host speed", not an
+// instruction-accurate model of the lx106.
+
+#include <cstdint>
+#include <vector>
+
+#ifndef F_CPU
+#define F_CPU 80000000L
+#endif
+
+namespace hal {
+
+using isr_t = void (*)(void *, void *);
+
+struct gpio_edge {
+    uint32_t cycles;
+    uint32_t mask;
+    bool level;
+};
+
+uint32_t cycles();
+void advance_cycles(uint32_t n);
+
+// GPOS/GPOC writes, recorded while trace_gpio is set
+extern bool trace_gpio;
+extern std::vector<gpio_edge> gpio_trace;
+
+struct gpio_reg {
+    bool level;
+    inline uint32_t operator=(uint32_t mask) {
+        if (trace_gpio)
+            gpio_trace.push_back({cycles(), mask, level});
+        return mask;
+    }
+};
+
+extern gpio_reg gpos;
+extern gpio_reg gpoc;
+
+// timer1
+void timer1_attach(isr_t isr, void *arg);
+void timer1_write(uint32_t ticks);
+void timer1_enable(uint8_t div, uint8_t edge, uint8_t reload);
+void timer1_disable();
+uint32_t timer1_load();
+uint32_t timer1_value();
+bool timer1_enabled();
+extern volatile uint32_t timer1_int;
+
+// calls the timer1 handler if its interval has elapsed
+void run_timer();
+
+extern bool quit;
+
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstdint>
+
+// The parts of lwIP's DNS client the firmware uses. Every name resolves to
+// 127.0.0.1 from the cache, the loopback WiFiUDP answers SNTP there.
+
+typedef int8_t err_t;
+static const err_t ERR_OK = 0;
+static const err_t ERR_INPROGRESS = -5;
+
+struct ip_addr_t {
+    uint32_t addr;  // network order, as in IPAddress
+};
+
+#define ip_2_ip4(ipaddr) (ipaddr)
+#define ip4_addr_get_u32(ipaddr) ((ipaddr)->addr)
+
+typedef void (*dns_found_callback)(const char *name, const ip_addr_t *ipaddr, void *callback_arg);
+
+inline err_t dns_gethostbyname(const char *hostname, ip_addr_t *addr, dns_found_callback found, void *callback_arg) {
+    addr->addr = 0x0100007f;
+    return ERR_OK;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+
+namespace espbase {
+
+// Extends the wrapping 32-bit cycle counter (ccount) to 64 bits. update()
+// has to see every wrap, that is run at least once per 2^32 cycles (53 s at
+// 80 MHz, 26 s at 160 MHz); loop() does.
+class cycle_clock {
+public:
+    inline uint64_t update(uint32_t ccount) {
+        if (ccount < m_low)
+            ++m_high;
+        m_low = ccount;
+        return now();
+    }
+
+    // as of the last update()
+    inline uint64_t now() const { return uint64_t(m_high) << 32 | m_low; }
+
+private:
+    uint32_t m_low = 0;
+    uint32_t m_high = 0;
+};
+
+// freq: cycles per second, a multiple of 1000
+constexpr uint64_t seconds_to_cycles(uint32_t s, uint32_t freq) { return uint64_t(s) * freq; }
+constexpr uint64_t ms_to_cycles(uint32_t ms, uint32_t freq) { return uint64_t(ms) * (freq / 1000); }
+constexpr uint32_t cycles_to_ms(uint64_t cycles, uint32_t freq) { return cycles / (freq / 1000); }
+
+}
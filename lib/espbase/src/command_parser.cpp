@@ -0,0 +1,306 @@
+#include <cstring>
+
+#include "command_parser.hpp"
+
+using espbase::command_parser;
+
+
+static inline bool is_space(char c) { return c == '\0' || c == '\t' || c == ' '; }
+static inline bool is_eol(char c) { return c == '\r' || c == '\n'; }
+
+static inline uint8_t hex_digit(char c) {
+    return (c >= '0' && c <= '9') ? c - '0' :
+           (c >= 'a' && c <= 'f') ? c - 'a' + 10 :
+           (c >= 'A' && c <= 'F') ? c - 'A' + 10 : 0xff;
+}
+
+
+void command_parser::parse(const char *data, size_t size) {
+    for (const char *p = data, *end = data + size; p < end; ++p) {
+        char c = *p;
+        bool after_cr = m_after_cr;
+        m_after_cr = false;
+
+        switch (m_state) {
+        case initial:
+            if (is_space(c) || (c == '\n' && after_cr))
+                break;
+
+            if (is_eol(c)) {
+                end_line(c);  // an empty line asks for the device name
+                break;
+            }
+
+            begin_token(p);
+            m_token_size = 1;
+            m_state = command;
+            break;
+
+        case command:
+            if (is_space(c)) {
+                m_command = token();
+                m_state = separator;
+            } else if (is_eol(c)) {
+                m_command = token();
+                end_line(c);
+            } else {
+                append(p);
+            }
+            break;
+
+        case separator:
+            if (is_space(c))
+                break;
+
+            if (is_eol(c)) {
+                end_line(c);
+            } else if (c == '\'') {
+                begin_token(p + 1);
+                m_state = quoted;
+            } else {
+                begin_token(p);
+                m_state = unquoted;
+
+                if (c != '\\') {
+                    m_token_size = 1;
+                } else {
+                    m_escape = true;
+                    if (!to_arena())
+                        fail(c);
+                }
+            }
+            break;
+
+        case unquoted:
+            if (m_escape) {
+                m_escape = false;
+                if (!append_copy(c))
+                    fail(c);
+            } else if (c == '\\') {
+                m_escape = true;
+                if (!to_arena())
+                    fail(c);
+            } else if (is_space(c) || is_eol(c)) {
+                end_arg(c);
+            } else if ((c == 'x' || c == 'X') && m_token_size == 1 && m_token[0] == '0') {
+                // decoded into the arena
+                m_token = m_arena + m_arena_used;
+                m_token_size = 0;
+                m_token_in_arena = true;
+                m_hex_half = false;
+                m_state = hex;
+            } else {
+                append(p);
+            }
+            break;
+
+        case quoted:
+            if (m_escape) {
+                m_escape = false;
+                if (!append_copy(c))
+                    fail(c);
+            } else if (c == '\\') {
+                m_escape = true;
+                if (!to_arena())
+                    fail(c);
+            } else if (c == '\'') {
+                if (push_arg())
+                    m_state = separator;
+                else
+                    fail(c);
+            } else {
+                append(p);
+            }
+            break;
+
+        case hex:
+            if (uint8_t digit = hex_digit(c); digit <= 0xf) {
+                if (!m_hex_half) {
+                    m_hex_high = digit;
+                    m_hex_half = true;
+                } else if (append_copy(m_hex_high << 4 | digit)) {
+                    m_hex_half = false;
+                } else {
+                    fail(c);
+                }
+            } else if ((is_space(c) || is_eol(c)) && !m_hex_half) {
+                end_arg(c);
+            } else {
+                fail(c);
+            }
+            break;
+
+        case error:
+            // the rest of the line is dropped
+            if (is_eol(c)) {
+                reset();
+                m_after_cr = c == '\r';
+            }
+            break;
+        }
+    }
+
+    if (m_state != initial && m_state != error)
+        save();
+}
+
+
+void command_parser::finish() {
+    if (m_state == initial)
+        return;
+
+    m_escape = false;
+
+    if (m_state == quoted) {
+        if (!push_arg())
+            return fail('\n');
+        m_state = separator;
+    }
+
+    // the open tokens are in the arena by now
+    static const char eol = '\n';
+    parse(&eol, 1);
+    m_after_cr = false;
+}
+
+
+void command_parser::begin_token(const char *at) {
+    m_token = at;
+    m_token_size = 0;
+    m_token_in_arena = false;
+}
+
+
+void command_parser::append(const char *at) {
+    if (!m_token_in_arena)
+        m_token_size++;  // still contiguous in the input
+    else if (!append_copy(*at))
+        fail(*at);
+}
+
+
+bool command_parser::append_copy(char c) {
+    // the open token is always the last thing in the arena
+    if (m_arena_used == arena_size)
+        return false;
+
+    m_arena[m_arena_used++] = c;
+    m_token_size++;
+    m_stats.copied++;
+    return true;
+}
+
+
+// points s to a copy at the end of the arena
+bool command_parser::copy(std::string_view& s) {
+    if (s.size() > arena_size - m_arena_used)
+        return false;
+
+    char *to = m_arena + m_arena_used;
+    std::memcpy(to, s.data(), s.size());
+    m_arena_used += s.size();
+    m_stats.copied += s.size();
+    s = {to, s.size()};
+    return true;
+}
+
+
+// moves the open token to the end of the arena, appends then go there
+bool command_parser::to_arena() {
+    if (m_token_in_arena && m_token + m_token_size == m_arena + m_arena_used)
+        return true;
+
+    auto s = token();
+    if (!copy(s))
+        return false;
+
+    m_token = s.data();
+    m_token_in_arena = true;
+    return true;
+}
+
+
+bool command_parser::push_arg() {
+    if (m_args.m_size == max_args)
+        return false;
+
+    m_args.m_args[m_args.m_size++] = token();
+    return true;
+}
+
+
+void command_parser::end_arg(char c) {
+    if (!push_arg())
+        return fail(c);
+
+    if (is_eol(c))
+        end_line(c);
+    else
+        m_state = separator;
+}
+
+
+void command_parser::end_line(char c) {
+    if (on_command)
+        on_command(m_command, m_args);
+
+    m_stats.commands++;
+    reset();
+    m_after_cr = c == '\r';
+}
+
+
+void command_parser::fail(char c) {
+    m_stats.errors++;
+    m_state = error;
+
+    if (is_eol(c)) {
+        reset();
+        m_after_cr = c == '\r';
+    }
+}
+
+
+void command_parser::reset() {
+    m_state = initial;
+    m_escape = false;
+    m_after_cr = false;
+    m_command = {};
+    m_args.m_size = 0;
+    m_arena_used = 0;
+}
+
+
+bool command_parser::in_arena(std::string_view s) const {
+    return s.data() >= m_arena && s.data() < m_arena + arena_size;
+}
+
+
+// The input goes away after parse() returns, so whatever of the open
+// command still points into it moves to the arena.
+void command_parser::save() {
+    bool open = m_state == command || m_state == unquoted || m_state == quoted || m_state == hex;
+    bool ok = true;
+
+    auto keep = [&](std::string_view& s) {
+        if (s.empty())
+            s = {};
+        else if (!in_arena(s))
+            ok &= copy(s);
+    };
+
+    if (m_state != command)
+        keep(m_command);
+
+    for (size_t i = 0; i < m_args.m_size; ++i)
+        keep(m_args.m_args[i]);
+
+    // appending continues at the end of the arena
+    if (ok && open)
+        ok = to_arena();
+
+    if (!ok) {
+        m_stats.errors++;
+        m_state = error;
+    }
+}
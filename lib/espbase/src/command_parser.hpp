@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string_view>
+
+namespace espbase {
+
+// Splits command lines into a command and its arguments, same grammar as
+// protocol.hpp: whitespace separated, 'quoted' values, backslash escapes
+// and 0x hex values, a line ends with \r or \n (\r\n counts once).
+//
+// Tokens are views into the input where they can be. Escaped and hex
+// values are written to a fixed per-command arena, as is everything of a
+// command still open at the end of a parse() call, since its input is gone
+// by the next one. Nothing is allocated while parsing.
+class command_parser {
+public:
+    static constexpr size_t arena_size = 256;
+    static constexpr size_t max_args = 8;
+
+    class arguments {
+    public:
+        inline size_t size() const { return m_size; }
+        inline bool empty() const { return m_size == 0; }
+        inline std::string_view operator[](size_t i) const { return m_args[i]; }
+        inline const std::string_view *begin() const { return m_args; }
+        inline const std::string_view *end() const { return m_args + m_size; }
+
+        // arguments from elsewhere, e.g. a binary request; false when full
+        inline bool push_back(std::string_view arg) {
+            if (m_size == max_args)
+                return false;
+            m_args[m_size++] = arg;
+            return true;
+        }
+
+    private:
+        friend class command_parser;
+        std::string_view m_args[max_args];
+        size_t m_size = 0;
+    };
+
+    struct stats {
+        uint32_t commands = 0;
+        uint32_t errors = 0;    // bad hex, too many or too long arguments
+        uint32_t copied = 0;    // bytes written to the arena
+    };
+
+    // the views are valid until it returns
+    std::function<void(std::string_view command, arguments const& args)> on_command;
+
+    void parse(const char *data, size_t size);
+    inline void parse(std::string_view data) { parse(data.data(), data.size()); }
+
+    // end of input, e.g. of a TCP read: runs a command waiting for its line end
+    void finish();
+
+    // a new connection, drops an open command
+    void reset();
+
+    inline stats const& statistics() const { return m_stats; }
+
+private:
+    enum state : uint8_t { initial, command, separator, unquoted, quoted, hex, error };
+
+    inline std::string_view token() const { return {m_token, m_token_size}; }
+
+    void begin_token(const char *at);
+    void append(const char *at);
+    bool append_copy(char c);
+    bool copy(std::string_view& s);
+    bool to_arena();
+    bool push_arg();
+    void end_arg(char c);
+    void end_line(char c);
+    void fail(char c);
+    void save();
+    bool in_arena(std::string_view s) const;
+
+    state m_state = initial;
+    bool m_escape = false;
+    bool m_after_cr = false;
+    bool m_hex_half = false;
+    bool m_token_in_arena = false;
+    uint8_t m_hex_high = 0;
+
+    const char *m_token = nullptr;
+    size_t m_token_size = 0;
+
+    std::string_view m_command;
+    arguments m_args;
+
+    char m_arena[arena_size];
+    size_t m_arena_used = 0;
+
+    stats m_stats;
+};
+
+}
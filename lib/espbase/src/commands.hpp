@@ -0,0 +1,113 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <string_view>
+
+#include "command_parser.hpp"
+
+namespace espbase {
+
+using command_args = command_parser::arguments;
+
+// A named command handler, a plain function pointer so tables of them can
+// be built at compile time. Captureless lambdas convert, [](auto&){ ... }
+// for those without arguments.
+struct command {
+    using handler = void (*)(command_args const& args);
+
+    const char *name = "";
+    handler run = nullptr;
+
+    constexpr command() = default;
+    constexpr command(const char *name, handler run): name(name), run(run) { }
+
+    inline void operator()(command_args const& args) const { run(args); }
+};
+static_assert(sizeof(command) == 2 * sizeof(void *), "a table entry is the name and the handler");
+
+
+namespace detail {
+    constexpr int compare(const char *a, const char *b) {
+        while (*a && *a == *b)
+            ++a, ++b;
+        return int(static_cast<unsigned char>(*a)) - int(static_cast<unsigned char>(*b));
+    }
+
+    constexpr int compare(std::string_view a, const char *b) {
+        for (char c : a) {
+            if (c != *b)
+                return int(static_cast<unsigned char>(c)) - int(static_cast<unsigned char>(*b));
+            ++b;
+        }
+        return *b ? -1 : 0;
+    }
+}
+
+
+// The commands sorted by name, at compile time when the result is constexpr:
+//   static constexpr auto commands = espbase::sorted_commands({
+//       {"on", [](auto&){ ... }},
+//       {"t0", [](espbase::command_args const& args){ ... }},
+//   });
+template<size_t N>
+constexpr std::array<command, N> sorted_commands(const command (&commands)[N]) {
+    std::array<command, N> sorted = {};
+
+    for (size_t i = 0; i < N; ++i) {
+        size_t j = i;
+        for (; j > 0 && detail::compare(commands[i].name, sorted[j - 1].name) < 0; --j)
+            sorted[j] = sorted[j - 1];
+        sorted[j] = commands[i];
+    }
+
+    return sorted;
+}
+
+// for static_assert on a sorted table
+template<size_t N>
+constexpr bool unique_names(std::array<command, N> const& sorted) {
+    for (size_t i = 1; i < N; ++i)
+        if (detail::compare(sorted[i - 1].name, sorted[i].name) == 0)
+            return false;
+    return true;
+}
+
+
+// A view of a sorted command table.
+class command_table {
+public:
+    constexpr command_table() = default;
+
+    template<size_t N>
+    constexpr command_table(std::array<command, N> const& sorted): m_begin(sorted.data()), m_size(N) { }
+
+    inline const command *begin() const { return m_begin; }
+    inline const command *end() const { return m_begin + m_size; }
+    inline size_t size() const { return m_size; }
+
+    // binary search, nullptr if there is no such command
+    const command *find(std::string_view name) const {
+        size_t lo = 0, hi = m_size;
+
+        while (lo < hi) {
+            size_t mid = (lo + hi) / 2;
+            int c = detail::compare(name, m_begin[mid].name);
+
+            if (c == 0)
+                return &m_begin[mid];
+            if (c < 0)
+                hi = mid;
+            else
+                lo = mid + 1;
+        }
+
+        return nullptr;
+    }
+
+private:
+    const command *m_begin = nullptr;
+    size_t m_size = 0;
+};
+
+}
@@ -0,0 +1,44 @@
+#include <lwip/dns.h>
+
+#include "dns.hpp"
+
+bool espbase::dns_lookup::update(uint32_t now) {
+    if (m_state == pending)
+        return false;
+
+    if (m_state == done)
+        return finish(now);
+
+    if (int32_t(now - m_next) < 0)
+        return false;
+
+    // the callback runs from the network stack between two loop() calls
+    ip_addr_t addr;
+    m_state = pending;
+    err_t err = dns_gethostbyname(m_host, &addr, [](const char *, const ip_addr_t *found, void *arg) {
+        auto *self = static_cast<dns_lookup *>(arg);
+        self->m_found = found ? ip4_addr_get_u32(ip_2_ip4(found)) : 0;
+        self->m_state = done;
+    }, this);
+
+    if (err == ERR_INPROGRESS)
+        return false;
+
+    // answered from the cache, or failed right away (no network yet)
+    m_found = (err == ERR_OK) ? ip4_addr_get_u32(ip_2_ip4(&addr)) : 0;
+    return finish(now);
+}
+
+bool espbase::dns_lookup::finish(uint32_t now) {
+    m_state = idle;
+
+    if (!m_found) {
+        m_next = now + retry_ms;
+        return false;
+    }
+
+    m_next = now + m_refresh;
+    bool changed = m_found != m_address;
+    m_address = m_found;
+    return changed;
+}
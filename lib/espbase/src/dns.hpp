@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdint>
+
+namespace espbase {
+
+// Looks a host name up with lwIP's DNS client in the background, where
+// WiFi.hostByName() waits up to 10 s for the answer. update() starts a
+// lookup when one is due, every refresh_ms or retry_ms after a failure, and
+// returns true when the address changed. Times are millis().
+class dns_lookup {
+public:
+    static constexpr uint32_t retry_ms = 10000;
+
+    dns_lookup(const char *host, uint32_t refresh_ms): m_host(host), m_refresh(refresh_ms) { }
+
+    bool update(uint32_t now);
+
+    inline const char *host() const { return m_host; }
+    // IPv4 as in IPAddress, 0 until a lookup succeeded
+    inline uint32_t address() const { return m_address; }
+
+private:
+    enum state : uint8_t { idle, pending, done };
+
+    bool finish(uint32_t now);
+
+    const char *m_host;
+    uint32_t m_refresh;
+
+    state m_state = idle;
+    uint32_t m_next = 0;
+    uint32_t m_found = 0;       // done: the result, 0 if it failed
+    uint32_t m_address = 0;
+};
+
+}
@@ -1,12 +1,19 @@
+#include <algorithm>
 #include <cassert>
 #include <cstdarg>
+#include <cstring>
 
 #include <ArduinoOTA.h>
 #include <EEPROM.h>
 #include <ESP8266WiFi.h>
 #include <WiFiServer.h>
 
-#include "protocol.hpp"
+#include "command_parser.hpp"
+#include "commands.hpp"
+#include "output.hpp"
+#include "profile.hpp"
+#include "rpc.hpp"
+#include "trace.hpp"
 
 #include "espbase.h"
 
@@ -14,19 +21,64 @@ std::function<void()> espbase::on_wifi_connected;
 
 static bool wifi_connected; 
 static WiFiServer server(0);
-static WiFiClient tcp;
-static std::vector<char> buffer;
+
+// A connection to the config port with its own parser state; text or
+// binary (rpc.hpp), decided by its first byte.
+enum class tcp_mode : uint8_t { unknown, text, binary };
+
+struct tcp_client {
+    WiFiClient tcp;
+    tcp_mode mode = tcp_mode::unknown;
+    bool active = false;
+    uint32_t last_read = 0;  // millis()
+    uint32_t bytes = 0;
+    uint32_t commands = 0;
+    espbase::command_parser parser;
+    espbase::rpc rpc;
+};
+
+// lwIP on the ESP8266 has 5 TCP connections by default, OTA needs one
+static const unsigned max_tcp_clients = 4;
+// per loop(), read round-robin in chunks so one busy client can't starve the others
+static const size_t tcp_read_budget = 1024;
+static const size_t tcp_read_chunk = 256;
+// a half-open peer (gone from the network without closing) is dropped
+// after idle + count * interval seconds without an answer to the probes
+static const uint16_t tcp_keepalive_idle_s = 60;
+static const uint16_t tcp_keepalive_interval_s = 10;
+static const uint8_t tcp_keepalive_count = 3;
+
+static tcp_client s_clients[max_tcp_clients];
+static unsigned s_next_client;
 
 Stream *espbase::dbg = nullptr;
+espbase::output espbase::out;
 
 using espbase::dbg;
+using espbase::out;
 
 
-static std::map<std::string, std::function<void(std::vector<std::vector<char>>&&)>> s_command_map;
-static protocol s_protocol;
+static espbase::command_table s_commands;
+static espbase::command_parser s_parser;
+static Print *s_command_output = nullptr;
 static espbase::config *s_config = nullptr;
 static espbase::config::meta *s_config_meta = nullptr;
 
+static espbase::profile_section perf_read_tcp("read_tcp");
+static espbase::profile_section perf_parse_command("parse_command");
+static espbase::profile_section perf_rpc("rpc");
+
+espbase::trace espbase::tracer(512);
+
+// where out goes: the client or the reply of the running command, else dbg
+static Print *output_sink() {
+    return s_command_output ? s_command_output : dbg;
+}
+
+#if !defined(__XTENSA__)
+uint32_t espbase::cycles() { return ESP.getCycleCount(); }
+#endif
+
 const char *espbase::device_id() {
     uint8_t mac[6];
     WiFi.macAddress(mac);
@@ -57,148 +109,276 @@ espbase::config::config(espbase::config::meta *meta):
     std::snprintf(meta->metadata("hostname")->default_value, sizeof(ssid), "esp-%s", espbase::device_id());
 }
 
-void espbase::command(const char *name, std::function<void()>&& callback) {
-    command(name, [callback](std::vector<std::vector<char>>&&){ callback(); });
+void espbase::parse_command(const char *data, size_t size) {
+    espbase::profile_scope perf(perf_parse_command);
+    s_parser.parse(data, size);
 }
 
-void espbase::command(const char *name, std::function<void(std::vector<std::vector<char>>&&)>&& callback) {
-    if (s_command_map.find(name) != s_command_map.end())
-        print(__FILE__ ": overriding command '%s'\n", name);
-    s_command_map[name] = callback;
+void espbase::set_commands(command_table const& commands) {
+    s_commands = commands;
 }
 
-void espbase::parse_command(std::vector<char>&& buf) {
-    s_protocol.parse(std::move(buf));
-}
 
-static void init_commands() {
-    s_protocol.command_callback = [](std::vector<char>&& command, std::vector<std::vector<char>>&& args) {
-        if (command.size() <= 1) {
-            espbase::print("esp-%s\n", espbase::device_id());
-            return;
-        }
+static void config_command(espbase::command_args const& args) {
+    if (args.size() == 2) {
+        char name[32] = {};
+        args[0].copy(name, sizeof(name) - 1);
 
-        auto itr = s_command_map.find(command.data());
+        auto ex_size = s_config_meta->size(name);
 
-        if (itr != s_command_map.end() && itr->second) {
-            espbase::print("command: %s\n", itr->first.c_str());
-            (itr->second)(std::move(args));
+        if (args[1].size() != ex_size)
+            espbase::print("warning: expected %u, got %u\n", unsigned(ex_size), unsigned(args[1].size()));
+
+        std::vector<char> value(ex_size, '\0');
+        args[1].copy(value.data(), ex_size);
+
+        if (s_config_meta->set(name, value.data()))
+            espbase::print("set %s\n", name);
+        else
+            espbase::print("config error: %s\n", name);
+    } else {
+        for (auto const &itr : s_config_meta->members()) {
+            std::vector<char> value(itr.second->type_info->size);
+            if (value.size() == 0)
+                continue;
+
+            itr.second->get(value.data());
+
+            espbase::print("config %s ", itr.first.c_str());
+
+            bool is_printable = itr.second->type_info->element_info == espbase::type_info<char>();
+            unsigned i = 0;
+            for (; i < value.size() && value[i]; ++i)
+                is_printable &= (value[i] >= 0x20) && (value[i] < 0x80);
+            for (; i < value.size(); ++i)
+                is_printable &= (value[i] == '\0');
+
+            if (is_printable) { // FIXME: escape
+                value.push_back('\0');
+                espbase::print("'%s'", value.data());
+            } else {
+                espbase::print("0x");
+                for (char v : value) {
+                    char *hex = out.reserve(2);
+                    hex[0] = espbase::to_hex(uint8_t(v) >> 4);
+                    hex[1] = espbase::to_hex(v & 0xf);
+                    out.commit(2);
+                }
+            }
             espbase::print("\n");
-        } else {
-            espbase::print("unknown: %s\n\n", command.data());
         }
-    };
+    }
+}
 
-    using espbase::command;
 
-    command("reset-config", []{ s_config_meta->reset_all(); });
-    command("config", [](std::vector<std::vector<char>>&& args) {
-        if (args.size() == 2) {
-            auto& opt = args[0];
-            auto& value = args[1];
-            opt.push_back('\0');
+static void perf_command(espbase::command_args const& args) {
+    // perf: all sections, perf <name>: histogram of one
+    if (args.size() == 1) {
+        for (auto *s = espbase::profile_section::first(); s; s = s->next()) {
+            if (args[0] != s->name())
+                continue;
 
-            auto ex_size = s_config_meta->size(opt.data());
+            auto& h = s->distribution();
+            for (unsigned i = 0; i < h.size(); ++i)
+                if (h.count(i))
+                    espbase::print("<= %10u: %u\n", h.upper(i), h.count(i));
+        }
+        return;
+    }
 
-            if (value.size() != ex_size)
-                espbase::print("warning: expected %u, got %u\n", ex_size, value.size());
+    espbase::print("%-16s %8s %8s %8s %8s %8s  (cycles)\n", "section", "count", "min", "mean", "p99", "max");
+    for (auto *s = espbase::profile_section::first(); s; s = s->next())
+        espbase::print("%-16s %8u %8u %8u %8u %8u\n", s->name(), s->count(),
+                       s->min(), s->mean(), s->distribution().percentile(99), s->max());
+}
 
-            value.resize(ex_size, '\0');
 
-            if (s_config_meta->set(opt.data(), value.data()))
-                espbase::print("set %s\n", opt.data());
-            else
-                espbase::print("config error: %s\n", opt.data());
-        } else {
-            for (auto const &itr : s_config_meta->members()) {
-                std::vector<char> value(itr.second->type_info->size);
-                if (value.size() == 0)
-                    continue;
-
-                itr.second->get(value.data());
-
-                espbase::print("config %s ", itr.first.c_str());
-
-                bool is_printable = itr.second->type_info->element_info == espbase::type_info<char>();
-                unsigned i = 0;
-                for (; i < value.size() && value[i]; ++i)
-                    is_printable &= (value[i] >= 0x20) && (value[i] < 0x80);
-                for (; i < value.size(); ++i)
-                    is_printable &= (value[i] == '\0');
-
-                if (is_printable) { // FIXME: escape
-                    value.push_back('\0');
-                    espbase::print("'%s'", value.data());
-                } else {
-                    espbase::print("0x");
-                    for (char v : value)
-                        espbase::print("%c%c", espbase::to_hex(v >> 4), espbase::to_hex(v & 0xf));
-                }
-                espbase::print("\n");
-            }
-        }
-    });
-    command("commands", []{
-        for (auto const &itr : s_command_map)
-            espbase::print("%s\n", itr.first.c_str());
-    });
-    command("device-name", []{ espbase::print("esp-%s\n", espbase::device_id()); });
-
-//     meta->onChange("builtin_led", []{
-//         digitalWrite(LED_BUILTIN, config->builtin_led);
-//     });
-// }
-
-// void EspBase::setup() {
-    // command("commit", []{
-    //     EEPROM.commit();
-    // });
-    command("restart", []{
-        ESP.restart();
-    });
-//     command("toggle-led", []{
-//         digitalWrite(LED_BUILTIN, !digitalRead(LED_BUILTIN));
-//         return 0;
-//     });
-
-    command("wifi", []{
-        if (!dbg)
-            return;
-
-        dbg->print("isConnected: ");
-        dbg->println(WiFi.isConnected());
-
-        dbg->print("localIP: ");
-        dbg->println(WiFi.localIP().toString());
-
-        dbg->print("MAC: ");
-        dbg->println(WiFi.macAddress());
-    });
-    command("wifi-scan", []{
-        if (!dbg)
-            STREAM_READ_RETURNS_INT;
-
-        dbg->println("scanning...");
-        int count = WiFi.scanNetworks();
-        if (count < 0)
-            return;
-
-        for (int i = 0; i < count; ++i) {
-            dbg->printf("%2d %2d dBm ", (i + 1), WiFi.RSSI(i));
-            switch (WiFi.encryptionType(i)) {
-            case ENC_TYPE_WEP:  dbg->print("WEP "); break;
-            case ENC_TYPE_TKIP: dbg->print("WPA "); break;
-            case ENC_TYPE_CCMP: dbg->print("WPA2"); break;
-            case ENC_TYPE_NONE: dbg->print("None"); break;
-            case ENC_TYPE_AUTO: dbg->print("Auto"); break;
-            }
-            dbg->print(' ');
-            dbg->println(WiFi.SSID(i));
+static void wifi_scan_command(espbase::command_args const&) {
+    // the scan takes seconds, say so first
+    out.println("scanning...");
+    out.flush();
+
+    int count = WiFi.scanNetworks();
+    if (count < 0)
+        return;
+
+    for (int i = 0; i < count; ++i) {
+        out.printf("%2d %2d dBm ", (i + 1), WiFi.RSSI(i));
+        switch (WiFi.encryptionType(i)) {
+        case ENC_TYPE_WEP:  out.print("WEP "); break;
+        case ENC_TYPE_TKIP: out.print("WPA "); break;
+        case ENC_TYPE_CCMP: out.print("WPA2"); break;
+        case ENC_TYPE_NONE: out.print("None"); break;
+        case ENC_TYPE_AUTO: out.print("Auto"); break;
         }
-    });
-    command("wifi-start", []{
-        espbase::start_wifi();
-    });
+        out.print(' ');
+        out.println(WiFi.SSID(i));
+    }
+}
+
+
+static void list_commands(espbase::command_args const&);
+static void list_clients(espbase::command_args const&);
+static void dump_trace(espbase::command_args const&);
+
+
+static constexpr auto s_builtin_array = espbase::sorted_commands({
+    {"reset-config",    [](auto&){ s_config_meta->reset_all(); }},
+    {"config",          config_command},
+    {"commands",        list_commands},
+    {"clients",         list_clients},
+    {"perf",            perf_command},
+    {"perf-reset",      [](auto&){
+        for (auto *s = espbase::profile_section::first(); s; s = s->next())
+            s->reset();
+    }},
+    {"trace",           dump_trace},
+    {"device-name",     [](auto&){ espbase::print("esp-%s\n", espbase::device_id()); }},
+    {"restart",         [](auto&){ ESP.restart(); }},
+    {"wifi",            [](auto&){
+        out.print("isConnected: ");
+        out.println(WiFi.isConnected());
+
+        out.print("localIP: ");
+        out.println(WiFi.localIP().toString());
+
+        out.print("MAC: ");
+        out.println(WiFi.macAddress());
+    }},
+    {"wifi-scan",       wifi_scan_command},
+    {"wifi-start",      [](auto&){ espbase::start_wifi(); }},
+});
+
+static_assert(espbase::unique_names(s_builtin_array));
+
+static constexpr espbase::command_table s_builtin_commands(s_builtin_array);
+
+// trace arg for the command, built-in ones have the top bit set
+static constexpr uint16_t builtin_index = 0x8000;
+
+
+static void list_commands(espbase::command_args const&) {
+    // both tables are sorted, app commands override built-in ones
+    auto a = s_commands.begin(), b = s_builtin_commands.begin();
+
+    while (a != s_commands.end() || b != s_builtin_commands.end()) {
+        int c = a == s_commands.end() ? 1 :
+                b == s_builtin_commands.end() ? -1 : espbase::detail::compare(a->name, b->name);
+
+        espbase::print("%s\n", c <= 0 ? a->name : b->name);
+        if (c <= 0)
+            ++a;
+        if (c >= 0)
+            ++b;
+    }
+}
+
+
+static void list_clients(espbase::command_args const&) {
+    static const char *const modes[] = {"new", "text", "binary"};
+
+    for (auto& c : s_clients) {
+        if (!c.active)
+            continue;
+
+        espbase::print("%u: %s:%u %-6s %8u bytes, %u commands, %u requests, %u s idle%s\n",
+                       unsigned(&c - s_clients), c.tcp.remoteIP().toString().c_str(), c.tcp.remotePort(),
+                       modes[unsigned(c.mode)], c.bytes, c.commands, c.rpc.statistics().requests,
+                       unsigned((millis() - c.last_read) / 1000), output_sink() == &c.tcp ? " (this)" : "");
+    }
+}
+
+
+static void dump_trace(espbase::command_args const&) {
+    // binary, decode with tools/trace.py
+    std::vector<espbase::trace::label> labels;
+    for (auto& c : s_commands)
+        labels.push_back({espbase::trace_command, uint16_t(&c - s_commands.begin()), c.name});
+    for (auto& c : s_builtin_commands)
+        labels.push_back({espbase::trace_command, uint16_t(builtin_index | (&c - s_builtin_commands.begin())), c.name});
+
+    espbase::tracer.dump([](const void *data, size_t size) {
+        out.write(reinterpret_cast<const char *>(data), size);
+    }, F_CPU, labels.data(), labels.size());
+}
+
+
+// nullptr if there is none, index: the trace arg
+static const espbase::command *find_command(std::string_view name, uint16_t& index) {
+    const espbase::command *command;
+
+    if ((command = s_commands.find(name)))
+        index = command - s_commands.begin();
+    else if ((command = s_builtin_commands.find(name)))
+        index = builtin_index | (command - s_builtin_commands.begin());
+
+    return command;
+}
+
+
+static void run_command(Print *sink, std::string_view name, espbase::command_args const& args) {
+    // everything a command prints goes out at once, at the end
+    s_command_output = sink;
+    out.sink(sink);
+
+    uint16_t index;
+    const espbase::command *command;
+
+    if (name.empty()) {
+        espbase::print("esp-%s\n", espbase::device_id());
+    } else if (!(command = find_command(name, index))) {
+        espbase::print("unknown: %.*s\n\n", int(name.size()), name.data());
+    } else {
+        espbase::tracer.record(espbase::trace_command, index);
+        espbase::print("command: %s\n", command->name);
+        (*command)(args);
+        out.write('\n');
+    }
+
+    out.flush();
+    s_command_output = nullptr;
+}
+
+
+// collects a command's output for a binary reply
+struct output_capture : Print {
+    std::vector<char>& to;
+
+    output_capture(std::vector<char>& to): to(to) { }
+
+    size_t write(uint8_t c) override {
+        to.push_back(c);
+        return 1;
+    }
+
+    size_t write(const uint8_t *data, size_t size) override {
+        to.insert(to.end(), data, data + size);
+        return size;
+    }
+
+    using Print::write;
+};
+
+
+static bool run_rpc_command(std::string_view name, espbase::command_args const& args, std::vector<char>& output) {
+    uint16_t index;
+    auto *command = find_command(name, index);
+    if (!command)
+        return false;
+
+    output_capture capture(output);
+    Print *connection = out.sink();
+
+    s_command_output = &capture;
+    out.sink(&capture);
+
+    espbase::tracer.record(espbase::trace_command, index);
+    (*command)(args);
+
+    out.flush();
+    out.sink(connection);
+    s_command_output = nullptr;
+    return true;
 }
 
 
@@ -217,7 +397,7 @@ void espbase::start_wifi() {
         //192.168.1.1 , 192.168.1.1 , 255.255.255.0
         WiFi.softAPConfig(0x0101A8C0, 0x0101A8C0, 0x00FFFFFF);
         if (dbg)
-            dbg->printf("wifi: %s %s\n", s_config->ssid.value, s_config->password.value);
+            espbase::print("wifi: %s %s\n", s_config->ssid.value, s_config->password.value);
         WiFi.softAP(s_config->ssid, s_config->password);
         break;
     }
@@ -227,71 +407,132 @@ static void connect_wifi() {
     if (WiFi.isConnected()) {
         if (!wifi_connected) {
             wifi_connected = true;
+            espbase::tracer.record(espbase::trace_wifi_up);
 
             if (espbase::on_wifi_connected)
                 espbase::on_wifi_connected();
         }
     } else {
-        if (wifi_connected)
+        if (wifi_connected) {
             wifi_connected = false;
+            espbase::tracer.record(espbase::trace_wifi_down);
+        }
     }
 }
 
-static void read_tcp() {
-    if (server.hasClient()) {
-        tcp.stop();
-        tcp = server.available();
-    }
-
-    while (tcp.connected()) {
-        int length = tcp.available();
-        if (length <= 0)
-            break;
+static void drop_client(tcp_client& c) {
+    c.tcp.stop();
+    c.active = false;
+    if (dbg == &c.tcp)
+        dbg = &Serial;
+}
 
-        buffer.resize(length);
-        length = tcp.read(reinterpret_cast<uint8_t *>(buffer.data()), buffer.size());
 
-        if (length > 0) {
-            if (dbg != &tcp)
-                dbg = &tcp;
+static void accept_clients() {
+    while (server.hasClient()) {
+        auto *c = std::find_if(std::begin(s_clients), std::end(s_clients),
+                               [](tcp_client const& c) { return !c.active; });
 
-            s_protocol.update(eof{});
-            s_protocol.parse(std::move(buffer));
-            s_protocol.update(eof{});
+        if (c == std::end(s_clients)) {
+            // the one quiet for the longest makes room, it may be half-open
+            uint32_t now = millis();
+            c = std::max_element(std::begin(s_clients), std::end(s_clients),
+                                 [now](tcp_client const& a, tcp_client const& b) {
+                                     return now - a.last_read < now - b.last_read; });
+            drop_client(*c);
+            espbase::tracer.record(espbase::trace_tcp_client, UINT16_MAX);
         }
+
+        c->tcp = server.available();
+        c->tcp.keepAlive(tcp_keepalive_idle_s, tcp_keepalive_interval_s, tcp_keepalive_count);
+        c->mode = tcp_mode::unknown;
+        c->active = true;
+        c->last_read = millis();
+        c->bytes = 0;
+        c->commands = 0;
+        c->parser.reset();
+        c->rpc.reset();
+        espbase::tracer.record(espbase::trace_tcp_client, c - s_clients);
     }
 }
 
-static int vprint(const char *format, std::va_list argp) {
-    int size = 0;
 
-    std::va_list argc;
-    va_copy(argc, argp);
-    size = std::vsnprintf(nullptr, 0, format, argc);
-    va_end(argc);
+// the bytes read, 0 when there was nothing
+static size_t poll_client(tcp_client& c, size_t max) {
+    if (!c.active)
+        return 0;
+
+    if (!c.tcp.connected()) {
+        drop_client(c);
+        return 0;
+    }
+
+    static char buffer[tcp_read_chunk];
+
+    int available = c.tcp.available();
+    if (available <= 0)
+        return 0;
+
+    int length = c.tcp.read(reinterpret_cast<uint8_t *>(buffer), std::min<size_t>({size_t(available), max, sizeof(buffer)}));
+    if (length <= 0)
+        return 0;
 
-    std::vector<char> print_buffer;
+    c.bytes += length;
+    c.last_read = millis();
 
-    if (size > 0) {
-        auto start = print_buffer.size();
-        print_buffer.resize(print_buffer.size() + size + 1);
+    // the first byte decides, see rpc.hpp
+    if (c.mode == tcp_mode::unknown)
+        c.mode = uint8_t(buffer[0]) == espbase::rpc::magic ? tcp_mode::binary : tcp_mode::text;
 
-        size = std::vsnprintf(print_buffer.data() + start, std::size_t(size) + 1, format, argp);
-        print_buffer.resize(start + size);
+    if (c.mode == tcp_mode::binary) {
+        espbase::profile_scope perf(perf_rpc);
+        out.sink(&c.tcp);
+        c.rpc.parse(buffer, length);
+        out.flush();
+    } else {
+        // output from outside of commands goes to the last one talking
+        dbg = &c.tcp;
+
+        espbase::profile_scope parse(perf_parse_command);
+        c.parser.parse(buffer, length);
+
+        // the end of what was sent ends the command, also without a line end
+        if (c.tcp.available() <= 0)
+            c.parser.finish();
     }
 
-    dbg->write(print_buffer.data(), print_buffer.size());
-    dbg->flush();
+    return length;
+}
 
-    return size;
+
+static void read_tcp() {
+    espbase::profile_scope perf(perf_read_tcp);
+
+    accept_clients();
+
+    // a chunk per client in turn, until all are idle or the budget is used up
+    size_t budget = tcp_read_budget;
+    for (unsigned idle = 0; budget && idle < max_tcp_clients; ) {
+        size_t length = poll_client(s_clients[s_next_client], budget);
+        s_next_client = (s_next_client + 1) % max_tcp_clients;
+
+        if (length) {
+            budget -= length;
+            idle = 0;
+        } else {
+            idle++;
+        }
+    }
 }
 
+
 int espbase::print(const char *format, ...) {
-    int size = 0;
+    // staged, see output.hpp
+    out.sink(output_sink());
 
     std::va_list argp;
     va_start(argp, format);
-    size = vprint(format, argp);
+    int size = out.vprintf(format, argp);
     va_end(argp);
 
     return size;
@@ -301,7 +542,26 @@ int espbase::print(const char *format, ...) {
 void espbase::setup() {
     assert(s_config);
 
-    init_commands();
+    tracer.name(trace_command, "command");
+    tracer.name(trace_wifi_up, "wifi_up");
+    tracer.name(trace_wifi_down, "wifi_down");
+    tracer.name(trace_tcp_client, "tcp_client");
+
+    s_parser.on_command = [](std::string_view name, espbase::command_args const& args) {
+        run_command(dbg, name, args);
+    };
+
+    for (auto& c : s_clients) {
+        c.parser.on_command = [&c](std::string_view name, espbase::command_args const& args) {
+            c.commands++;
+            run_command(&c.tcp, name, args);
+        };
+
+        c.rpc.meta = s_config_meta;
+        c.rpc.on_command = run_rpc_command;
+        c.rpc.on_reply = [](const char *data, size_t size) { out.write(data, size); };
+    }
+
     start_wifi();
 
     ArduinoOTA.setPort(40000);    
@@ -315,5 +575,9 @@ void espbase::loop() {
     connect_wifi();
     read_tcp();
 
+    // output from outside a command
+    if (out.pending())
+        out.flush();
+
     ArduinoOTA.handle();
 }
@@ -1,8 +1,10 @@
 #pragma once
 
-#include <vector>
+#include <cstddef>
 
+#include "commands.hpp"
 #include "configbase.hpp"
+#include "output.hpp"
 
 namespace espbase {
 
@@ -24,14 +26,17 @@ struct config : config_base {
 
 void setup();
 void loop();
-int print(const char *format, ...);
-void command(const char *name, std::function<void()>&& callback);
-void command(const char *name, std::function<void(std::vector<std::vector<char>>&&)>&& callback);
-void parse_command(std::vector<char>&& buf);
+// buffered in out, a command's output is flushed when it returns
+int print(const char *format, ...) __attribute__((format(printf, 1, 2)));
+// the app's commands, sorted, see commands.hpp; they override built-in ones
+void set_commands(command_table const& commands);
+// parsed in place, open commands are kept until their line ends
+void parse_command(const char *data, size_t size);
 void start_wifi();
 const char *device_id();
 
 extern Stream *dbg;
+extern output out;
 
 extern std::function<void()> on_wifi_connected;
 
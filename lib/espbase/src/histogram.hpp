@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+
+namespace espbase {
+
+// Counts samples in power of two buckets, bucket i > 0 holds [2^(i-1), 2^i),
+// bucket 0 holds 0 and the last one everything above. Cheap enough to
+// record() from an ISR; the counters are read from loop() without locking,
+// so a report can be off by the samples that came in while printing.
+template<unsigned Buckets = 24>
+class histogram {
+public:
+    static_assert(Buckets > 1 && Buckets <= 33);
+
+    __attribute__((always_inline)) inline void record(uint32_t value) {
+        unsigned b = value ? 32 - __builtin_clz(value) : 0;
+        if (b >= Buckets)
+            b = Buckets - 1;
+
+        m_counts[b] = m_counts[b] + 1;
+        m_total = m_total + 1;
+        if (value > m_max)
+            m_max = value;
+    }
+
+    inline void reset() {
+        for (auto& c : m_counts)
+            c = 0;
+        m_total = 0;
+        m_max = 0;
+    }
+
+    static constexpr unsigned size() { return Buckets; }
+
+    // largest value that lands in bucket i
+    static constexpr uint32_t upper(unsigned i) {
+        return i == 0 ? 0 : i >= 32 ? UINT32_MAX : (uint32_t(1) << i) - 1;
+    }
+
+    inline uint32_t count(unsigned i) const { return m_counts[i]; }
+    inline uint32_t total() const { return m_total; }
+    inline uint32_t max() const { return m_max; }
+
+    // upper bound of the bucket holding the p-th percentile, 0 when empty
+    inline uint32_t percentile(unsigned p) const {
+        uint64_t rank = (uint64_t(m_total) * p + 99) / 100;
+        uint32_t sum = 0;
+
+        for (unsigned i = 0; i < Buckets; ++i) {
+            sum += m_counts[i];
+            if (sum >= rank && sum)
+                return i == Buckets - 1 ? m_max : upper(i) < m_max ? upper(i) : m_max;
+        }
+
+        return 0;
+    }
+
+private:
+    volatile uint32_t m_counts[Buckets] = {};
+    volatile uint32_t m_total = 0;
+    volatile uint32_t m_max = 0;
+};
+
+}
@@ -0,0 +1,246 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+namespace espbase {
+
+// SNTP client that never waits: update() sends a request and returns, later
+// calls pick up the reply (or give up after a timeout). The first reply and
+// large offsets step the clock, smaller corrections are slewed in so the
+// time seen by the alarms never jumps or runs backwards.
+//
+// The server is an IPv4 address from set_server(), nothing is sent until
+// there is one. Name lookups are up to the caller, see dns_lookup: on the
+// ESP8266 beginPacket() with a host name waits for DNS.
+//
+// UDP is WiFiUDP or anything with the same begin, beginPacket, write,
+// endPacket, parsePacket and read. All times are passed in as millis().
+template<class UDP>
+class ntp_client {
+public:
+    static constexpr uint16_t port = 123;
+    static constexpr uint16_t local_port = 2390;
+    static constexpr uint32_t timeout_ms = 2000;
+    static constexpr uint32_t retry_ms = 10000;
+    static constexpr int32_t step_threshold_ms = 2000;  // larger offsets step
+    static constexpr uint32_t slew_rate = 20;           // 1 ms per 20 ms, 5 %
+
+    ntp_client(UDP& udp, int32_t offset_s, uint32_t interval_ms = 1024 * 1000):
+        m_udp(udp), m_offset_ms(int64_t(offset_s) * 1000), m_interval(interval_ms)
+    { }
+
+    inline void begin(uint32_t now) {
+        m_udp.begin(local_port);
+        m_state = idle;
+        m_next = now;
+    }
+
+    // the first address sends right away, later ones are used from the next request on
+    inline void set_server(uint32_t address, uint32_t now) {
+        if (!m_server && m_state == idle)
+            m_next = now;
+        m_server = address;
+    }
+
+    inline uint32_t server() const { return m_server; }
+    inline uint32_t interval() const { return m_interval; }
+
+    // true when a reply was applied
+    bool update(uint32_t now);
+
+    inline bool synced() const { return m_synced; }
+
+    // local time, 0 until synced
+    int64_t epoch_ms(uint32_t now) const;
+    inline int64_t epoch(uint32_t now) const { return epoch_ms(now) / 1000; }
+    inline int hours(uint32_t now) const { return epoch(now) % 86400 / 3600; }
+    std::string formatted_time(uint32_t now) const;
+
+    struct stats {
+        uint32_t sent = 0;
+        uint32_t received = 0;
+        uint32_t rejected = 0;  // malformed, kiss-of-death or stale
+        uint32_t timeouts = 0;
+        int32_t last_offset_ms = 0;  // 0 for the first sync
+        uint32_t last_rtt_ms = 0;
+    };
+
+    inline stats const& statistics() const { return m_stats; }
+
+    // correction still to be slewed in, ms
+    inline int32_t slew_remaining(uint32_t now) const { return m_slew - slewed(now); }
+
+private:
+    enum state : uint8_t { idle, waiting };
+
+    static constexpr uint32_t ntp_to_unix = 2208988800u;
+    static constexpr unsigned packet_size = 48;
+
+    bool send(uint32_t now);
+    bool receive(uint32_t now);
+    void apply(int64_t server_ms, uint32_t now);
+
+    // part of m_slew applied by now
+    inline int32_t slewed(uint32_t now) const {
+        int32_t done = (now - m_slew_start) / slew_rate;
+        return m_slew < 0 ? (done < -m_slew ? -done : m_slew)
+                          : (done < m_slew ? done : m_slew);
+    }
+
+    static inline uint32_t read32(const uint8_t *p) {
+        return uint32_t(p[0]) << 24 | uint32_t(p[1]) << 16 | uint32_t(p[2]) << 8 | p[3];
+    }
+
+    UDP& m_udp;
+    uint32_t m_server = 0;      // IPv4, as in IPAddress
+    int64_t m_offset_ms;
+    uint32_t m_interval;
+
+    state m_state = idle;
+    uint32_t m_next = 0;        // idle: when to send
+    uint32_t m_sent_at = 0;     // waiting: when the request went out
+    uint32_t m_cookie = 0;      // our transmit timestamp, echoed as originate
+
+    bool m_synced = false;
+    int64_t m_base_epoch = 0;   // UTC ms at m_base
+    uint32_t m_base = 0;
+    int32_t m_slew = 0;
+    uint32_t m_slew_start = 0;
+
+    stats m_stats;
+};
+
+
+template<class UDP>
+bool ntp_client<UDP>::update(uint32_t now) {
+    // keep now - m_base far from wrapping while running unsynced for weeks
+    if (m_synced && now - m_base > 86400000u) {
+        m_base_epoch = epoch_ms(now) - m_offset_ms;
+        m_slew -= slewed(now);
+        m_base = m_slew_start = now;
+    }
+
+    switch (m_state) {
+    case idle:
+        if (int32_t(now - m_next) < 0)
+            return false;
+
+        if (send(now)) {
+            m_state = waiting;
+            m_sent_at = now;
+        } else {
+            m_next = now + retry_ms;
+        }
+        return false;
+
+    case waiting:
+        if (receive(now)) {
+            m_state = idle;
+            m_next = now + m_interval;
+            return true;
+        }
+
+        if (now - m_sent_at >= timeout_ms) {
+            m_stats.timeouts++;
+            m_state = idle;
+            m_next = now + retry_ms;
+        }
+        return false;
+    }
+
+    return false;
+}
+
+template<class UDP>
+bool ntp_client<UDP>::send(uint32_t now) {
+    uint8_t packet[packet_size] = {};
+    packet[0] = 0x23;   // LI 0, version 4, mode 3 (client)
+
+    // any value the server echoes back, ties the reply to this request
+    m_cookie = m_cookie * 1103515245 + 12345 + now;
+    packet[40] = m_cookie >> 24;
+    packet[41] = m_cookie >> 16;
+    packet[42] = m_cookie >> 8;
+    packet[43] = m_cookie;
+
+    if (!m_server || !m_udp.beginPacket(m_server, port))
+        return false;
+
+    m_udp.write(packet, packet_size);
+    if (!m_udp.endPacket())
+        return false;
+
+    m_stats.sent++;
+    return true;
+}
+
+template<class UDP>
+bool ntp_client<UDP>::receive(uint32_t now) {
+    int size;
+    while ((size = m_udp.parsePacket()) > 0) {
+        uint8_t packet[packet_size];
+        if (size < int(packet_size) || m_udp.read(packet, packet_size) != int(packet_size)) {
+            m_stats.rejected++;
+            continue;
+        }
+
+        bool valid = (packet[0] & 0x07) == 4        // mode: server
+                  && packet[1] != 0                 // stratum 0: kiss-of-death
+                  && read32(&packet[24]) == m_cookie
+                  && read32(&packet[40]) != 0;
+
+        if (!valid) {
+            m_stats.rejected++;
+            continue;
+        }
+
+        uint32_t rtt = now - m_sent_at;
+        int64_t server_ms = int64_t(read32(&packet[40]) - ntp_to_unix) * 1000
+                          + ((uint64_t(read32(&packet[44])) * 1000 + (1u << 31)) >> 32);
+
+        m_stats.received++;
+        m_stats.last_rtt_ms = rtt;
+        apply(server_ms + rtt / 2, now);
+        return true;
+    }
+
+    return false;
+}
+
+template<class UDP>
+void ntp_client<UDP>::apply(int64_t server_ms, uint32_t now) {
+    int64_t current = epoch_ms(now) - m_offset_ms;
+    int64_t offset = server_ms - current;
+    m_stats.last_offset_ms = m_synced ? offset : 0;
+
+    if (!m_synced || offset > step_threshold_ms || offset < -step_threshold_ms) {
+        m_base_epoch = server_ms;
+        m_slew = 0;
+    } else {
+        m_base_epoch = current;
+        m_slew = offset;
+    }
+
+    m_base = m_slew_start = now;
+    m_synced = true;
+}
+
+template<class UDP>
+int64_t ntp_client<UDP>::epoch_ms(uint32_t now) const {
+    if (!m_synced)
+        return 0;
+    return m_base_epoch + (now - m_base) + slewed(now) + m_offset_ms;
+}
+
+template<class UDP>
+std::string ntp_client<UDP>::formatted_time(uint32_t now) const {
+    auto t = epoch(now) % 86400;
+    char buf[16];
+    std::snprintf(buf, sizeof(buf), "%02d:%02d:%02d", int(t / 3600), int(t / 60 % 60), int(t % 60));
+    return buf;
+}
+
+}
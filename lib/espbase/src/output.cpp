@@ -0,0 +1,109 @@
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "output.hpp"
+
+using espbase::output;
+
+
+void output::sink(Print *sink) {
+    if (sink != m_sink)
+        drain();
+    m_sink = sink;
+}
+
+
+size_t output::write(uint8_t c) {
+    if (m_used == buffer_size)
+        drain();
+
+    m_buffer[m_used++] = c;
+    return 1;
+}
+
+
+size_t output::write(const uint8_t *data, size_t size) {
+    for (size_t left = size; left; ) {
+        if (m_used == buffer_size)
+            drain();
+
+        size_t n = std::min(left, buffer_size - m_used);
+        std::memcpy(m_buffer + m_used, data, n);
+        m_used += n;
+        data += n;
+        left -= n;
+    }
+    return size;
+}
+
+
+int output::printf(const char *format, ...) {
+    std::va_list argp;
+    va_start(argp, format);
+    int size = vprintf(format, argp);
+    va_end(argp);
+    return size;
+}
+
+
+int output::vprintf(const char *format, std::va_list argp) {
+    std::va_list again;
+    va_copy(again, argp);
+
+    size_t space = buffer_size - m_used;
+    int size = std::vsnprintf(m_buffer + m_used, space, format, argp);
+
+    if (size >= 0 && size_t(size) < space) {
+        m_used += size;
+    } else if (size > 0 && size_t(size) < buffer_size) {
+        // formatted again after what is staged went out
+        drain();
+        std::vsnprintf(m_buffer, buffer_size, format, again);
+        m_used = size;
+    } else if (size > 0) {
+        std::vector<char> big(size + 1);
+        std::vsnprintf(big.data(), big.size(), format, again);
+        write(big.data(), size);
+    }
+
+    va_end(again);
+    return size;
+}
+
+
+char *output::reserve(size_t size) {
+    if (size > buffer_size)
+        return nullptr;
+
+    if (size > buffer_size - m_used)
+        drain();
+
+    return m_buffer + m_used;
+}
+
+
+void output::flush() {
+    drain();
+
+    if (m_sink) {
+        m_sink->flush();
+        m_stats.flushes++;
+    }
+}
+
+
+void output::drain() {
+    if (m_used == 0)
+        return;
+
+    if (m_sink) {
+        m_sink->write(reinterpret_cast<const uint8_t *>(m_buffer), m_used);
+        m_stats.writes++;
+        m_stats.bytes += m_used;
+    } else {
+        m_stats.dropped += m_used;
+    }
+
+    m_used = 0;
+}
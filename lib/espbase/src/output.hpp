@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdarg>
+#include <cstddef>
+#include <cstdint>
+
+#include <Arduino.h>
+
+namespace espbase {
+
+// Stages text for a sink (Serial, a TCP client) in a fixed buffer and
+// writes it in one piece when the buffer is full or on flush(), so a
+// command's output is one write and one sink flush instead of one per
+// print. printf() and reserve() format straight into the buffer.
+class output : public Print {
+public:
+    static constexpr size_t buffer_size = 512;
+
+    struct stats {
+        uint32_t writes = 0;    // to the sink
+        uint32_t flushes = 0;   // of the sink
+        uint32_t bytes = 0;
+        uint32_t dropped = 0;   // no sink
+    };
+
+    // pending output goes to the old sink first
+    void sink(Print *sink);
+    inline Print *sink() const { return m_sink; }
+
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t *data, size_t size) override;
+    using Print::write;
+
+    int printf(const char *format, ...) __attribute__((format(printf, 2, 3)));
+    int vprintf(const char *format, std::va_list argp);
+
+    // at least size bytes to format into, nullptr if it never fits; then
+    // commit() what was used
+    char *reserve(size_t size);
+    inline void commit(size_t size) { m_used += size; }
+
+    inline size_t pending() const { return m_used; }
+
+    // writes what is staged and flushes the sink
+    void flush() override;
+
+    inline stats const& statistics() const { return m_stats; }
+
+private:
+    void drain();
+
+    Print *m_sink = nullptr;
+    char m_buffer[buffer_size];
+    size_t m_used = 0;
+    stats m_stats;
+};
+
+}
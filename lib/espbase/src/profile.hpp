@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstdint>
+
+#include "histogram.hpp"
+
+namespace espbase {
+
+#if defined(__XTENSA__)
+__attribute__((always_inline)) inline uint32_t cycles() {
+    uint32_t ccount;
+    __asm__ __volatile__("rsr %0, ccount" : "=a"(ccount));
+    return ccount;
+}
+#else
+uint32_t cycles();
+#endif
+
+// Timing statistics for one named piece of code, in cycles. Sections link
+// themselves into a list on construction for the perf command, so define
+// them at namespace scope (a function local static would need a guard,
+// which is not safe in an ISR).
+class profile_section {
+public:
+    profile_section(const char *name): m_name(name), m_next(s_first) { s_first = this; }
+
+    profile_section(profile_section const&) = delete;
+
+    __attribute__((always_inline)) inline void record(uint32_t cycles) {
+        m_histogram.record(cycles);
+        m_total = m_total + cycles;
+        if (cycles < m_min)
+            m_min = cycles;
+    }
+
+    inline void reset() {
+        m_histogram.reset();
+        m_total = 0;
+        m_min = UINT32_MAX;
+    }
+
+    inline const char *name() const { return m_name; }
+    inline uint32_t count() const { return m_histogram.total(); }
+    inline uint32_t min() const { return count() ? m_min : 0; }
+    inline uint32_t max() const { return m_histogram.max(); }
+    inline uint32_t mean() const { return count() ? m_total / count() : 0; }
+    inline histogram<24> const& distribution() const { return m_histogram; }
+
+    inline profile_section *next() const { return m_next; }
+    static inline profile_section *first() { return s_first; }
+
+private:
+    const char *m_name;
+    histogram<24> m_histogram;
+    volatile uint64_t m_total = 0;
+    volatile uint32_t m_min = UINT32_MAX;
+    profile_section *m_next;
+
+    static inline profile_section *s_first = nullptr;
+};
+
+// Records the time from construction to the end of the enclosing block.
+class profile_scope {
+public:
+    __attribute__((always_inline)) inline profile_scope(profile_section& section):
+        m_section(section), m_start(cycles()) { }
+
+    __attribute__((always_inline)) inline ~profile_scope() { m_section.record(cycles() - m_start); }
+
+    profile_scope(profile_scope const&) = delete;
+
+private:
+    profile_section& m_section;
+    uint32_t m_start;
+};
+
+}
@@ -0,0 +1,260 @@
+#include <algorithm>
+#include <cstring>
+
+#include "crc.h"
+
+#include "rpc.hpp"
+
+using espbase::rpc;
+
+
+namespace {
+
+// a request's payload, stays failed once it ran out
+struct reader {
+    std::string_view data;
+    bool ok = true;
+
+    inline bool done() const { return !ok || data.empty(); }
+
+    std::string_view bytes(size_t size) {
+        if (size > data.size()) {
+            ok = false;
+            size = data.size();
+        }
+        auto s = data.substr(0, size);
+        data.remove_prefix(size);
+        return s;
+    }
+
+    inline uint8_t u8() {
+        auto s = bytes(1);
+        return ok ? uint8_t(s[0]) : 0;
+    }
+
+    inline uint16_t u16() {
+        auto s = bytes(2);
+        return ok ? uint8_t(s[0]) | uint8_t(s[1]) << 8 : 0;
+    }
+
+    // terminated in the frame, usable as a C string
+    const char *name() {
+        auto end = data.find('\0');
+        if (end == data.npos) {
+            ok = false;
+            return "";
+        }
+        return bytes(end + 1).data();
+    }
+};
+
+inline void put_u16(std::vector<char>& to, uint16_t value) {
+    to.push_back(value);
+    to.push_back(value >> 8);
+}
+
+}
+
+
+void rpc::parse(const char *data, size_t size) {
+    for (const char *p = data, *end = data + size; p < end; ) {
+        if (m_sync) {
+            if (uint8_t(*p++) == magic) {
+                m_sync = false;
+                m_frame.clear();
+            } else {
+                m_stats.skipped++;
+            }
+            continue;
+        }
+
+        // the length, then the rest of the frame
+        size_t want = m_frame.size() < 2 ? 2 : 2 + m_length + 2;
+        size_t n = std::min<size_t>(want - m_frame.size(), end - p);
+        m_frame.insert(m_frame.end(), p, p + n);
+        p += n;
+
+        if (m_frame.size() == 2) {
+            m_length = uint8_t(m_frame[0]) | uint8_t(m_frame[1]) << 8;
+
+            if (m_length == 0 || m_length > max_request) {
+                // the rest can't be trusted, on to the next magic
+                m_sync = true;
+                error(bad_length);
+            }
+            continue;
+        }
+
+        if (m_frame.size() < want)
+            continue;
+
+        m_sync = true;
+
+        uint16_t crc = uint8_t(m_frame[2 + m_length]) | uint8_t(m_frame[3 + m_length]) << 8;
+        if (crc != crc16(m_frame.data(), 2 + m_length)) {
+            error(bad_crc);
+            continue;
+        }
+
+        m_stats.requests++;
+        request(m_frame[2], {m_frame.data() + 3, m_length - 1});
+    }
+}
+
+
+void rpc::reset() {
+    m_sync = true;
+    m_frame.clear();
+    m_stats = {};
+}
+
+
+void rpc::request(uint8_t opcode, std::string_view payload) {
+    m_reply.clear();
+
+    switch (opcode) {
+    case op_get:        return get(payload);
+    case op_set:        return set(payload);
+    case op_command:    return command(payload);
+    default:            return error(bad_opcode);
+    }
+}
+
+
+uint8_t rpc::value_type(type_info_t const *info) {
+    auto *element = info->element_info;
+
+    if (element == type_info<char>())
+        return type_text | 1;
+    if (element == type_info<bool>())
+        return type_bool | 1;
+    if (element == type_info<int32_t>())
+        return type_int | 4;
+    return type_uint | element->size;
+}
+
+
+void rpc::get(std::string_view payload) {
+    auto put = [&](const char *name, const config_base::meta::data *member) {
+        size_t size = member ? member->type_info->size : 0;
+
+        m_reply.insert(m_reply.end(), name, name + std::strlen(name) + 1);
+        m_reply.push_back(member ? value_type(member->type_info) : 0);
+        put_u16(m_reply, size);
+
+        m_reply.resize(m_reply.size() + size);
+        if (member)
+            member->get(m_reply.data() + m_reply.size() - size);
+    };
+
+    if (payload.empty()) {
+        if (meta)
+            for (auto const& m : meta->members())
+                put(m.first.c_str(), m.second);
+        return reply(op_get);
+    }
+
+    reader in{payload};
+    while (!in.done())
+        in.name();
+    if (!in.ok)
+        return error(bad_payload);
+
+    for (reader in{payload}; !in.done(); ) {
+        const char *name = in.name();
+        put(name, member(name));
+    }
+    reply(op_get);
+}
+
+
+void rpc::set(std::string_view payload) {
+    reader in{payload};
+    while (!in.done()) {
+        in.name();
+        in.bytes(in.u16());
+    }
+    if (!in.ok)
+        return error(bad_payload);
+
+    for (reader in{payload}; !in.done(); ) {
+        const char *name = in.name();
+        auto value = in.bytes(in.u16());
+        auto *m = member(name);
+
+        if (!m) {
+            m_reply.push_back(unknown);
+        } else if (value.size() > m->type_info->size) {
+            m_reply.push_back(bad_size);
+        } else {
+            // zero padded like the config command
+            m_buffer.assign(m->type_info->size, '\0');
+            value.copy(m_buffer.data(), value.size());
+            meta->set(name, m_buffer.data());
+            m_reply.push_back(ok);
+        }
+    }
+    reply(op_set);
+}
+
+
+void rpc::command(std::string_view payload) {
+    auto arguments = [](reader& in, command_args& args) {
+        for (uint8_t argc = in.u8(); argc && in.ok; --argc)
+            if (!args.push_back(in.bytes(in.u16())))
+                in.ok = false;
+    };
+
+    reader in{payload};
+    while (!in.done()) {
+        command_args args;
+        in.name();
+        arguments(in, args);
+    }
+    if (!in.ok)
+        return error(bad_payload);
+
+    for (reader in{payload}; !in.done(); ) {
+        command_args args;
+        const char *name = in.name();
+        arguments(in, args);
+
+        m_buffer.clear();
+        bool found = on_command && on_command(name, args, m_buffer);
+        size_t size = std::min<size_t>(m_buffer.size(), UINT16_MAX);
+
+        m_reply.push_back(!found ? unknown : size < m_buffer.size() ? too_large : ok);
+        put_u16(m_reply, size);
+        m_reply.insert(m_reply.end(), m_buffer.begin(), m_buffer.begin() + size);
+    }
+    reply(op_command);
+}
+
+
+void rpc::error(status status) {
+    m_stats.errors++;
+    m_reply.assign(1, status);
+    reply(op_error);
+}
+
+
+void rpc::reply(uint8_t opcode) {
+    size_t length = 1 + m_reply.size();
+    if (length > UINT16_MAX)
+        return error(too_large);
+
+    m_buffer.clear();
+    m_buffer.push_back(magic);
+    put_u16(m_buffer, length);
+    m_buffer.push_back(opcode | op_reply);
+    m_buffer.insert(m_buffer.end(), m_reply.begin(), m_reply.end());
+    put_u16(m_buffer, crc16(m_buffer.data() + 1, 2 + length));
+
+    if (on_reply)
+        on_reply(m_buffer.data(), m_buffer.size());
+}
+
+
+const espbase::config_base::meta::data *rpc::member(const char *name) const {
+    return meta ? meta->metadata(name) : nullptr;
+}
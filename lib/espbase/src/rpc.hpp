@@ -0,0 +1,104 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string_view>
+#include <vector>
+
+#include "commands.hpp"
+#include "configbase.hpp"
+
+namespace espbase {
+
+// Binary requests on the config port, for tools rather than people, see
+// tools/rpc.py. A connection is binary if its first byte is the magic.
+// Frames, little endian:
+//   u8 magic, u16 length, u8 opcode, u8 payload[length - 1], u16 crc16
+// The CRC (crc.h) covers length, opcode and payload. A reply has the
+// opcode of its request | op_reply; bad frames get an op_error reply with
+// a status byte. Values are serialized as by the config command, with
+// their value_type in get replies.
+//
+//   get      name\0 ...                        all members without names
+//            -> (name\0 u8 type u16 size value) ...  size 0: no such member
+//   set      (name\0 u16 size value) ...       shorter values are zero padded
+//            -> u8 status ...
+//   command  (name\0 u8 argc (u16 size arg) ...) ...
+//            -> (u8 status u16 size output) ...
+//
+// Requests in one set are checked first and then applied in order, so a
+// malformed one changes nothing.
+class rpc {
+public:
+    static constexpr uint8_t magic = 0xb1;
+    static constexpr size_t max_request = 1024;    // length of a request
+
+    enum opcode : uint8_t {
+        op_get      = 0x01,
+        op_set      = 0x02,
+        op_command  = 0x03,
+        op_error    = 0x7f,
+        op_reply    = 0x80,
+    };
+
+    enum status : uint8_t {
+        ok,
+        unknown,        // member or command
+        bad_size,       // value larger than the member
+        bad_crc,
+        bad_length,     // 0 or more than max_request
+        bad_opcode,
+        bad_payload,    // truncated or too many arguments
+        too_large,      // the reply does not fit a frame
+    };
+
+    // a member's element type: the kind | the element size in bytes
+    enum value_type : uint8_t {
+        type_uint   = 0x00,     // big endian
+        type_int    = 0x10,     // big endian, two's complement
+        type_text   = 0x20,     // char[], zero padded
+        type_bool   = 0x30,
+    };
+
+    static uint8_t value_type(type_info_t const *info);
+
+    struct stats {
+        uint32_t requests = 0;
+        uint32_t errors = 0;
+        uint32_t skipped = 0;   // bytes while looking for the magic
+    };
+
+    // the config get and set work on
+    config_base::meta const *meta = nullptr;
+
+    // runs a command, false if there is none; it prints to output
+    std::function<bool(std::string_view name, command_args const& args, std::vector<char>& output)> on_command;
+
+    // one frame per call
+    std::function<void(const char *data, size_t size)> on_reply;
+
+    void parse(const char *data, size_t size);
+
+    // a new connection, drops a partial frame and the statistics
+    void reset();
+
+    inline stats const& statistics() const { return m_stats; }
+
+private:
+    void request(uint8_t opcode, std::string_view payload);
+    void get(std::string_view payload);
+    void set(std::string_view payload);
+    void command(std::string_view payload);
+    void error(status status);
+    void reply(uint8_t opcode);
+    const config_base::meta::data *member(const char *name) const;
+
+    bool m_sync = true;             // the next byte is a magic
+    size_t m_length = 0;
+    std::vector<char> m_frame;      // from the length on
+    std::vector<char> m_reply;      // payload
+    std::vector<char> m_buffer;     // values, command output, the reply frame
+    stats m_stats;
+};
+
+}
@@ -0,0 +1,45 @@
+#include "scheduler.hpp"
+
+void espbase::scheduler::add(const char *name, uint32_t period, uint32_t budget,
+                             std::function<void()>&& callback) {
+    m_tasks.push_back({name, period, budget, std::move(callback), m_cycles(), {}});
+}
+
+void espbase::scheduler::run() {
+    bool overran = false;
+
+    for (auto& t : m_tasks) {
+        uint32_t start = m_cycles();
+        if (int32_t(start - t.next) < 0)
+            continue;
+
+        if (overran) {
+            t.stats.deferred++;
+            continue;
+        }
+
+        t.callback();
+
+        uint32_t took = m_cycles() - start;
+        auto& s = t.stats;
+        s.runs++;
+        s.total += took;
+        if (took < s.min)
+            s.min = took;
+        if (took > s.max)
+            s.max = took;
+
+        t.next = start + t.period;
+
+        if (t.budget && took > t.budget) {
+            s.overruns++;
+            t.next += took - t.budget;
+            overran = true;
+        }
+    }
+}
+
+void espbase::scheduler::reset_stats() {
+    for (auto& t : m_tasks)
+        t.stats = {};
+}
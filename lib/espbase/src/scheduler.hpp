@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace espbase {
+
+// Cooperative scheduler for loop(). Tasks run in the order they were added,
+// which is also their priority, each at most once per period (0: every
+// run()). A task that takes longer than its budget is deferred by the time
+// it ran over, and the tasks after it wait for the next run() so the ones
+// before it get to go first again. Times are in cycles of the given clock.
+class scheduler {
+public:
+    struct stats {
+        uint32_t runs = 0;
+        uint32_t min = UINT32_MAX;
+        uint32_t max = 0;
+        uint64_t total = 0;
+        uint32_t overruns = 0;  // took longer than the budget
+        uint32_t deferred = 0;  // was due but waited for a later run()
+
+        inline uint32_t avg() const { return runs ? total / runs : 0; }
+    };
+
+    struct task {
+        const char *name;
+        uint32_t period;
+        uint32_t budget;  // 0: unlimited
+        std::function<void()> callback;
+        uint32_t next;
+        struct stats stats;
+    };
+
+    scheduler(uint32_t (*cycles)()): m_cycles(cycles) { }
+
+    void add(const char *name, uint32_t period, uint32_t budget, std::function<void()>&& callback);
+    void run();
+    void reset_stats();
+
+    inline std::vector<task> const& tasks() const { return m_tasks; }
+
+private:
+    uint32_t (*m_cycles)();
+    std::vector<task> m_tasks;
+};
+
+}
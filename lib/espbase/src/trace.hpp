@@ -0,0 +1,174 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+#include <ringbuffer.h>
+
+#include "profile.hpp"
+
+namespace espbase {
+
+// Events recorded by espbase itself, applications number theirs from
+// trace_user up and name them with trace::name().
+enum trace_event : uint8_t {
+    trace_command,      // arg: which command, see the trace command
+    trace_wifi_up,
+    trace_wifi_down,
+    trace_tcp_client,   // arg: its slot, 0xffff when all were taken and the longest idle made room
+    trace_user = 16,
+    trace_max_events = 64,
+};
+
+
+// Fixed-size ring of cycle-stamped events for timing bugs, full rings drop
+// the oldest. record() is safe from ISRs: it only holds interrupts off for
+// the push. dump() writes the ring in the format read by tools/trace.py and
+// clears it, events recorded meanwhile are counted as lost.
+class trace {
+public:
+    struct entry {
+        uint32_t cycles;
+        uint8_t event;
+        uint8_t reserved;
+        uint16_t arg;
+    };
+
+    static_assert(sizeof(entry) == 8, "entry is written as is");
+
+    // a label for one value of one event's arg, e.g. command names
+    struct label {
+        uint8_t event;
+        uint16_t arg;
+        const char *text;
+    };
+
+    static constexpr char magic[4] = {'T', 'R', 'C', '1'};
+
+    trace(size_t size): m_ring(size) { }
+
+    trace(trace const&) = delete;
+
+    inline void name(uint8_t event, const char *name) {
+        if (event < trace_max_events)
+            m_names[event] = name;
+    }
+
+    __attribute__((always_inline)) inline void record(uint8_t event, uint16_t arg = 0) {
+        uint32_t ps = lock();
+
+        if (m_paused) {
+            m_lost = m_lost + 1;
+        } else {
+            if (m_ring.available() == 0)
+                m_lost = m_lost + 1;
+            m_ring.push_back(entry{cycles(), event, 0, arg});
+        }
+
+        unlock(ps);
+    }
+
+    inline size_t size() const { return m_ring.size(); }
+    inline size_t max_size() const { return m_ring.max_size(); }
+    inline uint32_t lost() const { return m_lost; }
+    inline entry const& operator[](size_t i) const { return m_ring[i]; }
+
+    inline void clear() {
+        uint32_t ps = lock();
+        m_ring.clear();
+        m_lost = 0;
+        unlock(ps);
+    }
+
+    // write(const void *, size_t), little-endian:
+    //   "TRC1", u32 cpu_hz, u32 entries, u32 lost, u16 names, u16 labels
+    //   names:   u8 event, name, '\0'
+    //   labels:  u8 event, u16 arg, text, '\0'
+    //   entries: u32 cycles, u8 event, u8 0, u16 arg
+    template<class Write>
+    void dump(Write&& write, uint32_t cpu_hz, const label *labels = nullptr, uint16_t label_count = 0) {
+        m_paused = true;
+
+        uint16_t names = 0;
+        for (auto *n : m_names)
+            names += n != nullptr;
+
+        uint32_t count = m_ring.size();
+        uint32_t lost = m_lost;
+
+        write(magic, sizeof(magic));
+        write(&cpu_hz, 4);
+        write(&count, 4);
+        write(&lost, 4);
+        write(&names, 2);
+        write(&label_count, 2);
+
+        for (uint8_t i = 0; i < trace_max_events; ++i) {
+            if (!m_names[i])
+                continue;
+            write(&i, 1);
+            write(m_names[i], std::strlen(m_names[i]) + 1);
+        }
+
+        for (uint16_t i = 0; i < label_count; ++i) {
+            write(&labels[i].event, 1);
+            write(&labels[i].arg, 2);
+            write(labels[i].text, std::strlen(labels[i].text) + 1);
+        }
+
+        // paused, the ISR leaves the ring alone
+        for (size_t i = 0; i < count; ++i)
+            write(&m_ring[i], sizeof(entry));
+
+        // what was lost meanwhile shows up in the next dump
+        uint32_t ps = lock();
+        m_ring.clear();
+        m_lost = m_lost - lost;
+        m_paused = false;
+        unlock(ps);
+    }
+
+private:
+#if defined(__XTENSA__)
+    __attribute__((always_inline)) static inline uint32_t lock() {
+        uint32_t ps;
+        __asm__ __volatile__("rsil %0, 15" : "=a"(ps) :: "memory");
+        return ps;
+    }
+
+    __attribute__((always_inline)) static inline void unlock(uint32_t ps) {
+        __asm__ __volatile__("wsr %0, ps; rsync" :: "a"(ps) : "memory");
+    }
+#else
+    static inline uint32_t lock() { return 0; }
+    static inline void unlock(uint32_t) { }
+#endif
+
+    ring_buffer<entry> m_ring;
+    volatile uint32_t m_lost = 0;
+    volatile bool m_paused = false;
+    const char *m_names[trace_max_events] = {};
+};
+
+
+// scoped pair of events, e.g. ISR entry and exit
+class trace_scope {
+public:
+    __attribute__((always_inline)) inline trace_scope(trace& t, uint8_t enter, uint8_t exit, uint16_t arg = 0):
+        m_trace(t), m_exit(exit), m_arg(arg)
+    {
+        m_trace.record(enter, arg);
+    }
+
+    __attribute__((always_inline)) inline ~trace_scope() { m_trace.record(m_exit, m_arg); }
+
+private:
+    trace& m_trace;
+    uint8_t m_exit;
+    uint16_t m_arg;
+};
+
+
+extern trace tracer;
+
+}
@@ -0,0 +1,73 @@
+#include <cassert>
+#include <cstdio>
+#include <random>
+
+#include "test.h"
+
+#include "../src/clock.hpp"
+
+using espbase::cycle_clock;
+
+int main() {
+    test("wraparound", []{
+        cycle_clock clock;
+        assert(clock.update(0xfffffff0) == 0xfffffff0);
+        assert(clock.update(0x00000010) == 0x100000010);
+        assert(clock.update(0x00000010) == 0x100000010);
+        assert(clock.update(0xffffffff) == 0x1ffffffff);
+        assert(clock.update(0x00000000) == 0x200000000);
+        assert(clock.now() == 0x200000000);
+    });
+
+    test("long_run", []{
+        // 30 days at 80 MHz with irregular loop() passes of up to half a wrap
+        const uint32_t freq = 80000000;
+        const uint64_t end = espbase::seconds_to_cycles(30 * 86400, freq);
+
+        std::mt19937 rng(1);
+        std::uniform_int_distribution<uint32_t> step(1, 1u << 31);
+
+        cycle_clock clock;
+        uint64_t real = 0;
+
+        while (real < end) {
+            real += step(rng);
+            assert(clock.update(uint32_t(real)) == real);
+        }
+
+        assert(espbase::cycles_to_ms(clock.now(), freq) == real / (freq / 1000));
+    });
+
+    test("no_drift", []{
+        // two hours of short loop() passes, the previous double accumulation
+        // of seconds drifts
+        const uint32_t freq = 80000000;
+        const uint64_t end = espbase::seconds_to_cycles(2 * 3600, freq);
+
+        std::mt19937 rng(2);
+        std::uniform_int_distribution<uint32_t> step(1000, 20000);
+
+        cycle_clock clock;
+        uint64_t real = 0;
+        double t = 0;
+
+        while (real < end) {
+            uint32_t interval = step(rng);
+            real += interval;
+            t += double(interval) / freq;
+            clock.update(uint32_t(real));
+        }
+
+        assert(clock.now() == real);
+        std::printf("    double accumulation error: %.3g s\n", t - double(real) / freq);
+    });
+
+    test("conversions", []{
+        const uint32_t freq = 160000000;
+        assert(espbase::ms_to_cycles(1500, freq) == 240000000);
+        assert(espbase::cycles_to_ms(espbase::ms_to_cycles(0xffffffff, freq), freq) == 0xffffffff);
+        assert(espbase::seconds_to_cycles(90 * 60, freq) == 864000000000ull);
+    });
+
+    return 0;
+}
@@ -0,0 +1,172 @@
+#include <cassert>
+#include <string>
+#include <vector>
+
+#include "test.h"
+
+#include "../src/command_parser.hpp"
+#include "../src/command_parser.cpp"
+#include "../src/protocol.hpp"
+
+struct line {
+    std::string command;
+    std::vector<std::string> args;
+
+    bool operator==(line const& o) const { return command == o.command && args == o.args; }
+};
+
+using lines = std::vector<line>;
+
+static lines parse_chunks(std::string const& input, size_t chunk, espbase::command_parser& p) {
+    lines out;
+    p.on_command = [&](std::string_view command, espbase::command_parser::arguments const& args) {
+        line l{std::string(command), {}};
+        for (auto a : args)
+            l.args.emplace_back(a);
+        out.push_back(l);
+    };
+
+    for (size_t i = 0; i < input.size(); i += chunk) {
+        // a fresh copy per read, the old one is overwritten afterwards
+        std::string read = input.substr(i, chunk);
+        p.parse(read);
+        std::fill(read.begin(), read.end(), '#');
+    }
+    return out;
+}
+
+static lines parse_chunks(std::string const& input, size_t chunk) {
+    espbase::command_parser p;
+    return parse_chunks(input, chunk, p);
+}
+
+static lines parse_old(std::string const& input) {
+    lines out;
+    protocol p;
+    p.command_callback = [&](std::vector<char>&& command, std::vector<std::vector<char>>&& args) {
+        line l{command.data(), {}};
+        for (auto& a : args)
+            l.args.emplace_back(a.begin(), a.end());
+        out.push_back(l);
+    };
+    p.parse(std::vector<char>(input.begin(), input.end()));
+    return out;
+}
+
+static const std::string corpus =
+    "d\n"
+    "on\n"
+    "t0 120\n"
+    "config led_brightness 0xff\n"
+    "config hostname 'wake-up light'\n"
+    "config ssid 'it\\'s mine'\n"
+    "config password es\\ caped\n"
+    "config ramp 0x00000000000000006666ffff66663333\n"
+    "config alarms 0X1e007F00\n"
+    "perf  calc_colors\t\n"
+    "config x ''\n";
+
+int main() {
+    test("simple", []{
+        auto out = parse_chunks("on\nconfig led_brightness 0xff\n", 1000);
+        assert(out.size() == 2);
+        assert(out[0] == (line{"on", {}}));
+        assert(out[1] == (line{"config", {"led_brightness", "\xff"}}));
+    });
+
+    test("same_as_protocol", []{
+        auto expected = parse_old(corpus);
+        assert(expected.size() == 11);
+        assert(parse_chunks(corpus, corpus.size()) == expected);
+    });
+
+    test("split_reads", []{
+        auto expected = parse_chunks(corpus, corpus.size());
+        for (size_t chunk = 1; chunk < 40; ++chunk)
+            assert(parse_chunks(corpus, chunk) == expected);
+    });
+
+    test("zero_copy", []{
+        espbase::command_parser p;
+        parse_chunks("on\nt0 120\nconfig hostname 'wake-up light'\n", 1000, p);
+        assert(p.statistics().commands == 3);
+        assert(p.statistics().copied == 0);
+
+        // only escapes and hex go to the arena
+        parse_chunks("config password es\\ caped\nconfig x 0xabcd\n", 1000, p);
+        assert(p.statistics().copied == 2 + 6 + 2);
+    });
+
+    test("line_ends", []{
+        auto out = parse_chunks("on\r\noff\r\rd\n\n", 1000);
+        assert(out.size() == 5);
+        assert(out[0].command == "on");
+        assert(out[1].command == "off");
+        assert(out[2].command == "");   // empty line: device name
+        assert(out[3].command == "d");
+        assert(out[4].command == "");
+    });
+
+    test("errors", []{
+        espbase::command_parser p;
+        auto out = parse_chunks("config x 0xabc\non\nconfig x 0xzz y\nd\n", 1000, p);
+        assert(out.size() == 2);
+        assert(out[0].command == "on");
+        assert(out[1].command == "d");
+        assert(p.statistics().errors == 2);
+
+        out = parse_chunks("a 1 2 3 4 5 6 7 8 9\non\n", 1000, p);
+        assert(out.size() == 1 && out[0].command == "on");
+    });
+
+    test("arena_full", []{
+        espbase::command_parser p;
+        std::string big = "config x 0x" + std::string(2 * espbase::command_parser::arena_size + 2, 'a') + "\non\n";
+        auto out = parse_chunks(big, 1000, p);
+        assert(out.size() == 1 && out[0].command == "on");
+        assert(p.statistics().errors == 1);
+
+        // split reads need the arena for everything so far
+        std::string long_arg = "config x " + std::string(espbase::command_parser::arena_size + 1, 'b') + "\non\n";
+        out = parse_chunks(long_arg, 16, p);
+        assert(out.size() == 1 && out[0].command == "on");
+    });
+
+    test("finish", []{
+        espbase::command_parser p;
+        lines out;
+        p.on_command = [&](std::string_view command, espbase::command_parser::arguments const& args) {
+            out.push_back({std::string(command), {}});
+            for (auto a : args)
+                out.back().args.emplace_back(a);
+        };
+
+        p.parse("config hostname 'x y");
+        assert(out.empty());
+        p.finish();
+        assert(out.size() == 1);
+        assert(out[0] == (line{"config", {"hostname", "x y"}}));
+
+        p.finish();
+        p.parse("t0 5");
+        p.finish();
+        assert(out.size() == 2 && out[1] == (line{"t0", {"5"}}));
+    });
+
+    test("reset", []{
+        espbase::command_parser p;
+        parse_chunks("config hostname 'x y", 1000, p);
+        p.reset();
+        auto out = parse_chunks("on\n", 1000, p);
+        assert(out.size() == 1 && out[0] == (line{"on", {}}));
+
+        // a \r at the end of the old connection does not eat the \n
+        parse_chunks("on\r", 1000, p);
+        p.reset();
+        out = parse_chunks("\non\n", 1000, p);
+        assert(out.size() == 2);
+        assert(out[0].command == "" && out[1].command == "on");
+    });
+
+    return 0;
+}
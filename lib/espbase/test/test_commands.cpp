@@ -0,0 +1,67 @@
+#include <cassert>
+#include <string>
+
+#include "test.h"
+
+#include "../src/commands.hpp"
+#include "../src/command_parser.cpp"
+
+static std::string ran;
+static espbase::command_args no_args;
+
+static constexpr auto commands = espbase::sorted_commands({
+    {"t0",      [](auto&){ ran = "t0"; }},
+    {"on",      [](auto&){ ran = "on"; }},
+    {"config",  [](espbase::command_args const& args){ ran = "config " + std::to_string(args.size()); }},
+    {"off",     [](auto&){ ran = "off"; }},
+    {"d",       [](auto&){ ran = "d"; }},
+    {"d3_lo",   [](auto&){ ran = "d3_lo"; }},
+    {"d3_hi",   [](auto&){ ran = "d3_hi"; }},
+});
+
+static_assert(espbase::unique_names(commands));
+static_assert(espbase::detail::compare(commands[0].name, "config") == 0);
+static_assert(!espbase::unique_names(espbase::sorted_commands({{"on", [](auto&){}}, {"off", [](auto&){}}, {"on", [](auto&){}}})));
+
+static constexpr espbase::command_table table(commands);
+
+int main() {
+    test("sorted", []{
+        for (size_t i = 1; i < table.size(); ++i)
+            assert(std::string(table.begin()[i - 1].name) < table.begin()[i].name);
+    });
+
+    test("find", []{
+        for (auto& c : commands) {
+            auto *found = table.find(c.name);
+            assert(found == &c);
+            (*found)(no_args);
+            assert(ran.rfind(c.name, 0) == 0);
+        }
+
+        assert(table.find("config")->run != nullptr);
+        assert(table.find("on")->run != nullptr);
+    });
+
+    test("not_found", []{
+        assert(!table.find(""));
+        assert(!table.find("o"));
+        assert(!table.find("onn"));
+        assert(!table.find("d3"));
+        assert(!table.find("zz"));
+        assert(!espbase::command_table().find("on"));
+    });
+
+    test("arguments", []{
+        espbase::command_parser p;
+        p.on_command = [](std::string_view name, espbase::command_args const& args) {
+            if (auto *c = table.find(name))
+                (*c)(args);
+        };
+
+        p.parse("config a b\n");
+        assert(ran == "config 2");
+    });
+
+    return 0;
+}
@@ -0,0 +1,54 @@
+#include <cassert>
+
+#include "test.h"
+
+#include "../src/histogram.hpp"
+
+using espbase::histogram;
+
+int main() {
+    test("buckets", []{
+        histogram<8> h;
+        h.record(0);
+        h.record(1);
+        h.record(2);
+        h.record(3);
+        h.record(127);
+        h.record(128);
+        h.record(100000);
+
+        assert(h.count(0) == 1);
+        assert(h.count(1) == 1);
+        assert(h.count(2) == 2);
+        assert(h.count(7) == 3);  // 127 and everything above
+        assert(h.total() == 7);
+        assert(h.max() == 100000);
+
+        assert(histogram<8>::upper(0) == 0);
+        assert(histogram<8>::upper(3) == 7);
+        assert(histogram<33>::upper(32) == UINT32_MAX);
+    });
+
+    test("percentile", []{
+        histogram<24> h;
+        assert(h.percentile(50) == 0);
+
+        for (unsigned i = 0; i < 99; ++i)
+            h.record(1000);
+        assert(h.percentile(50) == 1000);  // clamped to the max seen
+
+        h.record(50000);
+        assert(h.percentile(50) == 1023);
+        assert(h.percentile(99) == 1023);
+        assert(h.percentile(100) == 50000);
+    });
+
+    test("reset", []{
+        histogram<24> h;
+        h.record(5);
+        h.reset();
+        assert(h.total() == 0 && h.max() == 0 && h.count(3) == 0);
+    });
+
+    return 0;
+}
@@ -0,0 +1,269 @@
+#include <cassert>
+#include <cstring>
+#include <deque>
+#include <vector>
+
+#include "test.h"
+
+#include "../src/ntp.hpp"
+
+// stand-in for WiFiUDP and an NTP server behind it
+class fake_udp {
+public:
+    using packet = std::vector<uint8_t>;
+
+    bool online = true;
+    std::deque<packet> requests;    // sent by the client
+    std::deque<packet> replies;     // waiting for parsePacket()
+
+    void begin(uint16_t) { }
+
+    uint32_t server = 0;
+
+    int beginPacket(uint32_t address, uint16_t port) {
+        assert(port == 123);
+        server = address;
+        m_out.clear();
+        return online;
+    }
+
+    size_t write(const uint8_t *data, size_t size) {
+        m_out.insert(m_out.end(), data, data + size);
+        return size;
+    }
+
+    int endPacket() {
+        requests.push_back(m_out);
+        return 1;
+    }
+
+    int parsePacket() {
+        if (replies.empty())
+            return 0;
+        m_in = replies.front();
+        replies.pop_front();
+        return m_in.size();
+    }
+
+    int read(uint8_t *data, size_t size) {
+        size = std::min(size, m_in.size());
+        std::memcpy(data, m_in.data(), size);
+        return size;
+    }
+
+    // answers the oldest request with the given UTC time
+    void respond(int64_t unix_ms, uint8_t stratum = 2, uint8_t mode = 4, bool echo = true) {
+        assert(!requests.empty());
+        auto request = requests.front();
+        requests.pop_front();
+
+        packet reply(48, 0);
+        reply[0] = 0x20 | mode;
+        reply[1] = stratum;
+        if (echo)
+            std::memcpy(&reply[24], &request[40], 8);
+
+        uint32_t secs = unix_ms / 1000 + 2208988800u;
+        uint32_t frac = uint64_t(unix_ms % 1000) * (uint64_t(1) << 32) / 1000;
+        for (unsigned i = 0; i < 4; ++i) {
+            reply[40 + i] = secs >> (24 - 8 * i);
+            reply[44 + i] = frac >> (24 - 8 * i);
+        }
+
+        replies.push_back(reply);
+    }
+
+private:
+    packet m_out;
+    packet m_in;
+};
+
+using ntp = espbase::ntp_client<fake_udp>;
+
+static const int64_t server_time = 1704585600000;  // Sunday 2024-01-07 00:00 UTC
+static const uint32_t server_ip = 0x0102a8c0;       // 192.168.2.1
+
+// begin() with the server's address already known
+static void start(ntp& client, uint32_t now) {
+    client.begin(now);
+    client.set_server(server_ip, now);
+}
+
+// first sync at now, reply after 100 ms
+static void sync(ntp& client, fake_udp& udp, uint32_t& now, int64_t server_ms) {
+    client.update(now);
+    assert(udp.requests.size() == 1);
+    now += 100;
+    udp.respond(server_ms + 50);
+    assert(client.update(now));
+}
+
+int main() {
+    test("never_waits", []{
+        fake_udp udp;
+        ntp client(udp, 0);
+        start(client, 1000);
+
+        assert(!client.update(1000));
+        assert(udp.requests.size() == 1);
+        assert(!client.synced());
+        assert(client.epoch_ms(1000) == 0);
+
+        // no reply: gives up after the timeout and retries later
+        for (uint32_t now = 1001; now < 1000 + ntp::timeout_ms; ++now)
+            assert(!client.update(now));
+        client.update(1000 + ntp::timeout_ms);
+        assert(client.statistics().timeouts == 1);
+
+        client.update(1000 + ntp::timeout_ms + ntp::retry_ms - 1);
+        assert(udp.requests.size() == 1);
+        client.update(1000 + ntp::timeout_ms + ntp::retry_ms);
+        assert(udp.requests.size() == 2);
+    });
+
+    test("waits_for_address", []{
+        fake_udp udp;
+        ntp client(udp, 0);
+        client.begin(0);
+
+        // no address yet, e.g. DNS still busy: nothing goes out
+        client.update(0);
+        client.update(ntp::retry_ms);
+        assert(udp.requests.empty() && client.statistics().sent == 0);
+
+        // the first address sends right away
+        client.set_server(server_ip, ntp::retry_ms + 1);
+        client.update(ntp::retry_ms + 1);
+        assert(udp.requests.size() == 1 && udp.server == server_ip);
+
+        // a new one is used from the next request on
+        uint32_t now = ntp::retry_ms + 100;
+        udp.respond(server_time);
+        assert(client.update(now));
+        client.set_server(server_ip + 1, now);
+        client.update(now + client.interval());
+        assert(udp.requests.size() == 1 && udp.server == server_ip + 1);
+    });
+
+    test("offline", []{
+        fake_udp udp;
+        udp.online = false;
+        ntp client(udp, 0);
+        start(client, 0);
+
+        client.update(0);
+        assert(client.statistics().sent == 0);
+        udp.online = true;
+        client.update(ntp::retry_ms);
+        assert(client.statistics().sent == 1);
+    });
+
+    test("first_sync_steps", []{
+        fake_udp udp;
+        ntp client(udp, 3600);
+        uint32_t now = 5000;
+        start(client, now);
+
+        sync(client, udp, now, server_time);
+        assert(client.synced());
+        assert(client.epoch_ms(now) == server_time + 100 + 3600 * 1000);
+        assert(client.hours(now) == 1);
+        assert(client.formatted_time(now) == "01:00:00");
+        assert(client.statistics().last_rtt_ms == 100);
+    });
+
+    test("small_offset_slews", []{
+        for (int32_t offset : {500, -500}) {
+            fake_udp udp;
+            ntp client(udp, 0);
+            uint32_t now = 0;
+            start(client, now);
+            sync(client, udp, now, server_time);
+
+            // next sync, the server is ahead or behind by offset
+            now += 1024 * 1000;
+            client.update(now);
+            int64_t before = client.epoch_ms(now + 100);
+            int64_t server = server_time + 100 + 1024 * 1000 + offset;
+
+            now += 100;
+            udp.respond(server + 50);
+            assert(client.update(now));
+            assert(client.statistics().last_offset_ms == offset);
+
+            // no jump, never backwards, and fully applied after |offset| * 20 ms
+            assert(client.epoch_ms(now) == before);
+            int64_t last = client.epoch_ms(now);
+
+            for (uint32_t t = now + 1; t <= now + 11000; ++t) {
+                int64_t e = client.epoch_ms(t);
+                assert(e >= last);
+                last = e;
+            }
+
+            assert(client.slew_remaining(now + 11000) == 0);
+            assert(client.epoch_ms(now + 11000) == server + 100 + 11000);
+        }
+    });
+
+    test("large_offset_steps", []{
+        fake_udp udp;
+        ntp client(udp, 0);
+        uint32_t now = 0;
+        start(client, now);
+        sync(client, udp, now, server_time);
+
+        now += 1024 * 1000;
+        client.update(now);
+        now += 100;
+        udp.respond(server_time + 1024 * 1000 + 60000 + 50);
+        assert(client.update(now));
+
+        assert(client.epoch_ms(now) == server_time + 1024 * 1000 + 60000 + 100);
+        assert(client.slew_remaining(now) == 0);
+    });
+
+    test("rejects_bad_replies", []{
+        fake_udp udp;
+        ntp client(udp, 0);
+        start(client, 0);
+        client.update(0);
+
+        auto request = udp.requests.front();
+        udp.requests.insert(udp.requests.end(), 4, request);
+
+        udp.respond(server_time, 0);                // kiss-of-death
+        udp.respond(server_time, 2, 3);             // not a server
+        udp.respond(server_time, 2, 4, false);      // not for our request
+        udp.replies.push_back(fake_udp::packet(20, 0));
+
+        assert(!client.update(10));
+        assert(client.statistics().rejected == 4);
+        assert(!client.synced());
+
+        udp.respond(server_time);
+        assert(client.update(20));
+        assert(client.synced());
+    });
+
+    test("millis_wraparound", []{
+        fake_udp udp;
+        ntp client(udp, 0);
+        uint32_t now = 0xffffff00;
+        start(client, now);
+        sync(client, udp, now, server_time);
+
+        int64_t before = client.epoch_ms(now);
+        assert(client.epoch_ms(now + 0x200) == before + 0x200);
+
+        // weeks without a reply
+        for (unsigned day = 0; day < 60; ++day) {
+            now += 86400000u;
+            client.update(now);
+            udp.requests.clear();
+        }
+        assert(client.epoch_ms(now) == before + 60 * int64_t(86400000));
+    });
+
+    return 0;
+}
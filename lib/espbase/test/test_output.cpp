@@ -0,0 +1,119 @@
+#include <cassert>
+#include <string>
+#include <vector>
+
+#include "test.h"
+
+#include "../src/output.hpp"
+#include "../src/output.cpp"
+
+// records what reaches the sink, one entry per write
+struct sink : Print {
+    std::vector<std::string> writes;
+    unsigned flushes = 0;
+
+    size_t write(uint8_t c) override { return write(&c, 1); }
+    size_t write(const uint8_t *data, size_t size) override {
+        writes.emplace_back(reinterpret_cast<const char *>(data), size);
+        return size;
+    }
+    using Print::write;
+    void flush() override { flushes++; }
+
+    std::string all() const {
+        std::string s;
+        for (auto& w : writes)
+            s += w;
+        return s;
+    }
+};
+
+int main() {
+    test("one_write_per_flush", []{
+        sink s;
+        espbase::output out;
+        out.sink(&s);
+
+        out.printf("command: %s\n", "config");
+        for (unsigned i = 0; i < 20; ++i)
+            out.printf("%c%c", 'a' + i, 'A' + i);
+        out.print("\n");
+        assert(s.writes.empty());
+
+        out.flush();
+        assert(s.writes.size() == 1);
+        assert(s.flushes == 1);
+        assert(s.writes[0].size() == 16 + 40 + 1);
+        assert(out.pending() == 0);
+    });
+
+    test("full_buffer", []{
+        sink s;
+        espbase::output out;
+        out.sink(&s);
+
+        std::string expected;
+        for (unsigned i = 0; i < 100; ++i) {
+            out.printf("line %u\n", i);
+            expected += "line " + std::to_string(i) + "\n";
+        }
+        out.flush();
+
+        assert(s.all() == expected);
+        assert(s.writes.size() == (expected.size() + espbase::output::buffer_size - 1) / espbase::output::buffer_size);
+        for (size_t i = 0; i + 1 < s.writes.size(); ++i)
+            assert(s.writes[i].size() <= espbase::output::buffer_size);
+    });
+
+    test("bigger_than_buffer", []{
+        sink s;
+        espbase::output out;
+        out.sink(&s);
+
+        std::string big(3 * espbase::output::buffer_size, 'x');
+        out.print("a");
+        assert(out.printf("%s", big.c_str()) == int(big.size()));
+        out.write(big.data(), big.size());
+        out.flush();
+        assert(s.all() == "a" + big + big);
+    });
+
+    test("reserve", []{
+        sink s;
+        espbase::output out;
+        out.sink(&s);
+
+        std::string expected;
+        for (unsigned i = 0; i < 1000; ++i) {
+            char *p = out.reserve(2);
+            p[0] = '0' + i % 10;
+            p[1] = ',';
+            out.commit(2);
+            expected += p[0];
+            expected += ',';
+        }
+        out.flush();
+        assert(s.all() == expected);
+        assert(!out.reserve(espbase::output::buffer_size + 1));
+    });
+
+    test("sink_change", []{
+        sink a, b;
+        espbase::output out;
+
+        out.print("lost");
+        out.sink(&a);
+        out.print("to a");
+        out.sink(&b);
+        out.print("to b");
+        out.flush();
+
+        assert(a.all() == "to a" && a.flushes == 0);
+        assert(b.all() == "to b" && b.flushes == 1);
+        assert(out.statistics().dropped == 4);
+        assert(out.statistics().writes == 2);
+        assert(out.statistics().bytes == 8);
+    });
+
+    return 0;
+}
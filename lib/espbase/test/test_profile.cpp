@@ -0,0 +1,48 @@
+#include <cassert>
+
+#include "test.h"
+
+#include "../src/profile.hpp"
+
+static uint32_t now;
+uint32_t espbase::cycles() { return now; }
+
+static espbase::profile_section section_a("a");
+static espbase::profile_section section_b("b");
+
+int main() {
+    test("registered", []{
+        auto *s = espbase::profile_section::first();
+        assert(s == &section_b);
+        assert(s->next() == &section_a);
+        assert(s->next()->next() == nullptr);
+    });
+
+    test("scope", []{
+        for (uint32_t t : {100, 300, 200}) {
+            espbase::profile_scope perf(section_a);
+            now += t;
+        }
+
+        assert(section_a.count() == 3);
+        assert(section_a.min() == 100);
+        assert(section_a.max() == 300);
+        assert(section_a.mean() == 200);
+        assert(section_a.distribution().count(8) == 1);  // 128..255
+        assert(section_a.distribution().count(9) == 1);
+        assert(section_b.count() == 0 && section_b.min() == 0);
+    });
+
+    test("reset", []{
+        section_a.reset();
+        assert(section_a.count() == 0 && section_a.max() == 0 && section_a.mean() == 0);
+
+        {
+            espbase::profile_scope perf(section_a);
+            now += 7;
+        }
+        assert(section_a.min() == 7);
+    });
+
+    return 0;
+}
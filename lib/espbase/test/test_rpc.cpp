@@ -0,0 +1,196 @@
+#include <cassert>
+#include <string>
+#include <vector>
+
+#include "test.h"
+
+#include "../src/rpc.hpp"
+#include "../src/rpc.cpp"
+#include "../../ecg-serial/src/crc.cpp"
+
+using espbase::rpc;
+
+static espbase::config_base::meta config_meta;
+struct test_config : espbase::config_base {
+    member<uint8_t>     brightness  = {&config_meta, "brightness", 0x80};
+    member<uint16_t>    speed       = {&config_meta, "speed",      0x0100};
+    member<char[8]>     name        = {&config_meta, "name",       {}};
+    member<bool>        enabled     = {&config_meta, "enabled",    true};
+    member<uint16_t[2]> pair        = {&config_meta, "pair",       {}};
+    member<int32_t>     offset      = {&config_meta, "offset",     -2};
+};
+
+static std::string frame(uint8_t opcode, std::string const& payload) {
+    std::string f;
+    uint16_t length = 1 + payload.size();
+    f += char(rpc::magic);
+    f += char(length);
+    f += char(length >> 8);
+    f += char(opcode);
+    f += payload;
+    uint16_t crc = crc16(f.data() + 1, f.size() - 1);
+    f += char(crc);
+    f += char(crc >> 8);
+    return f;
+}
+
+static std::string u16(uint16_t value) { return {char(value), char(value >> 8)}; }
+static std::string cstr(const char *s) { return std::string(s) + '\0'; }
+
+struct reply {
+    uint8_t opcode;
+    std::string payload;
+};
+
+static std::vector<reply> replies;
+
+static void parse(rpc& r, std::string const& data, size_t chunk = SIZE_MAX) {
+    for (size_t i = 0; i < data.size(); i += chunk)
+        r.parse(data.data() + i, std::min(chunk, data.size() - i));
+}
+
+static rpc make_rpc() {
+    rpc r;
+    r.meta = &config_meta;
+    r.on_reply = [](const char *data, size_t size) {
+        // the reply is framed like a request
+        std::string f(data, size);
+        assert(uint8_t(f[0]) == rpc::magic);
+        uint16_t length = uint8_t(f[1]) | uint8_t(f[2]) << 8;
+        assert(f.size() == 3u + length + 2u);
+        uint16_t crc = uint8_t(f[3 + length]) | uint8_t(f[4 + length]) << 8;
+        assert(crc == crc16(f.data() + 1, 2 + length));
+        replies.push_back({uint8_t(f[3]), f.substr(4, length - 1)});
+    };
+    r.on_command = [](std::string_view name, espbase::command_args const& args, std::vector<char>& output) {
+        if (name != "echo")
+            return false;
+        for (auto a : args)
+            output.insert(output.end(), a.begin(), a.end());
+        return true;
+    };
+    return r;
+}
+
+int main() {
+    static test_config config;
+    config_meta.reset_all();
+
+    test("get_all", []{
+        replies.clear();
+        rpc r = make_rpc();
+        parse(r, frame(rpc::op_get, ""));
+
+        assert(replies.size() == 1);
+        assert(replies[0].opcode == (rpc::op_get | rpc::op_reply));
+        assert(replies[0].payload ==
+               cstr("brightness") + "\x01" + u16(1) + "\x80" +
+               cstr("enabled") + "\x31" + u16(1) + "\x01" +
+               cstr("name") + "\x21" + u16(8) + std::string(8, '\0') +
+               cstr("offset") + "\x14" + u16(4) + "\xff\xff\xff\xfe" +
+               cstr("pair") + "\x02" + u16(4) + std::string(4, '\0') +
+               cstr("speed") + "\x02" + u16(2) + std::string("\x01\x00", 2));
+    });
+
+    test("get_some", []{
+        replies.clear();
+        rpc r = make_rpc();
+        parse(r, frame(rpc::op_get, cstr("speed") + cstr("nope")));
+        assert(replies[0].payload == cstr("speed") + "\x02" + u16(2) + std::string("\x01\x00", 2) +
+                                     cstr("nope") + std::string(1, '\0') + u16(0));
+    });
+
+    test("set", []{
+        replies.clear();
+        rpc r = make_rpc();
+
+        int changes = 0;
+        config_meta.on_change("speed", [&]{ ++changes; });
+
+        parse(r, frame(rpc::op_set,
+                       cstr("speed") + u16(2) + "\x12\x34" +
+                       cstr("name") + u16(3) + "abc" +
+                       cstr("brightness") + u16(2) + "xx" +
+                       cstr("nope") + u16(1) + "x"));
+
+        assert(replies.size() == 1);
+        assert((replies[0].payload == std::string{rpc::ok, rpc::ok, rpc::bad_size, rpc::unknown}));
+        assert(config.speed == 0x1234);
+        assert(std::string(config.name.value) == "abc");
+        assert(config.brightness == 0x80);
+        assert(changes == 1);
+
+        // malformed: nothing changes
+        parse(r, frame(rpc::op_set, cstr("speed") + u16(2) + "\x00\x01" + cstr("name") + u16(5) + "ab"));
+        assert(replies.size() == 2);
+        assert(replies[1].opcode == (rpc::op_error | rpc::op_reply));
+        assert(replies[1].payload == std::string{rpc::bad_payload});
+        assert(config.speed == 0x1234);
+
+        config_meta.on_change("speed", nullptr);
+    });
+
+    test("command", []{
+        replies.clear();
+        rpc r = make_rpc();
+        parse(r, frame(rpc::op_command,
+                       cstr("echo") + "\x02" + u16(2) + "ab" + u16(0) +
+                       cstr("what") + std::string(1, '\0')));
+
+        assert(replies.size() == 1);
+        assert(replies[0].payload == std::string{rpc::ok} + u16(2) + "ab" + std::string{rpc::unknown} + u16(0));
+
+        std::string many = cstr("echo") + char(espbase::command_parser::max_args + 1);
+        for (unsigned i = 0; i <= espbase::command_parser::max_args; ++i)
+            many += u16(1) + "x";
+        parse(r, frame(rpc::op_command, many));
+        assert(replies[1].payload == std::string{rpc::bad_payload});
+    });
+
+    test("split_and_pipelined", []{
+        replies.clear();
+        rpc r = make_rpc();
+        std::string both = frame(rpc::op_set, cstr("brightness") + u16(1) + "\x42") + frame(rpc::op_get, cstr("brightness"));
+
+        for (size_t chunk = 1; chunk < both.size(); ++chunk)
+            parse(r, both, chunk);
+
+        assert(replies.size() == 2 * (both.size() - 1));
+        for (size_t i = 0; i < replies.size(); i += 2) {
+            assert(replies[i].payload == std::string{rpc::ok});
+            assert(replies[i + 1].payload == cstr("brightness") + "\x01" + u16(1) + "\x42");
+        }
+        assert(r.statistics().requests == replies.size());
+        assert(r.statistics().errors == 0);
+    });
+
+    test("bad_frames", []{
+        replies.clear();
+        rpc r = make_rpc();
+
+        std::string bad = frame(rpc::op_get, cstr("speed"));
+        bad[5] ^= 1;
+        parse(r, "junk" + bad + frame(rpc::op_get, cstr("speed")));
+        assert(replies.size() == 2);
+        assert(replies[0].opcode == (rpc::op_error | rpc::op_reply));
+        assert(replies[0].payload == std::string{rpc::bad_crc});
+        assert(replies[1].opcode == (rpc::op_get | rpc::op_reply));
+        assert(r.statistics().skipped == 4);
+
+        // too long: skipped up to the next magic
+        std::string big = std::string(1, char(rpc::magic)) + u16(rpc::max_request + 1) + "xyz";
+        parse(r, big + frame(0x42, ""));
+        assert(replies.size() == 4);
+        assert(replies[2].payload == std::string{rpc::bad_length});
+        assert(replies[3].payload == std::string{rpc::bad_opcode});
+
+        // a new connection starts over
+        parse(r, frame(rpc::op_get, "").substr(0, 4));
+        r.reset();
+        parse(r, frame(rpc::op_get, cstr("speed")));
+        assert(replies.size() == 5);
+        assert(replies[4].opcode == (rpc::op_get | rpc::op_reply));
+    });
+
+    return 0;
+}
@@ -0,0 +1,93 @@
+#include <cassert>
+
+#include "test.h"
+
+#include "../src/scheduler.hpp"
+#include "../src/scheduler.cpp"
+
+static uint32_t now;
+static uint32_t cycles() { return now; }
+
+int main() {
+    test("periods", []{
+        now = 0;
+        espbase::scheduler s(cycles);
+
+        unsigned every = 0, slow = 0;
+        s.add("every", 0, 0, [&]{ ++every; now += 10; });
+        s.add("slow", 1000, 0, [&]{ ++slow; now += 10; });
+
+        while (now < 10000)
+            s.run();
+
+        // slow runs at 0, 1000, ... and the time it takes delays nothing
+        assert(slow == 10);
+        assert(every == s.tasks()[0].stats.runs);
+        assert(every > 900);
+    });
+
+    test("overrun_deferred", []{
+        now = 0;
+        espbase::scheduler s(cycles);
+
+        unsigned render = 0, ntp = 0, serial = 0;
+        s.add("render", 100, 50, [&]{ ++render; now += 20; });
+        s.add("ntp", 1000, 100, [&]{ ++ntp; now += 1100; });
+        s.add("serial", 0, 0, [&]{ ++serial; now += 1; });
+
+        s.run();
+        assert(render == 1 && ntp == 1);
+
+        // serial waits for the next run, after render got its turn
+        assert(serial == 0);
+        assert(s.tasks()[2].stats.deferred == 1);
+        assert(s.tasks()[1].stats.overruns == 1);
+
+        s.run();
+        assert(render == 2 && serial == 1);
+
+        // ntp started at 20 and is pushed back by its 1000 cycle overrun on
+        // top of the period
+        while (now < 2000)
+            s.run();
+        assert(ntp == 1);
+
+        while (now < 2200)
+            s.run();
+        assert(ntp == 2);
+    });
+
+    test("stats", []{
+        now = 0;
+        espbase::scheduler s(cycles);
+
+        uint32_t cost = 10;
+        s.add("task", 0, 0, [&]{ now += cost; cost += 10; });
+
+        s.run();
+        s.run();
+        s.run();
+
+        auto& st = s.tasks()[0].stats;
+        assert(st.runs == 3);
+        assert(st.min == 10 && st.max == 30 && st.avg() == 20);
+
+        s.reset_stats();
+        assert(s.tasks()[0].stats.runs == 0);
+    });
+
+    test("wraparound", []{
+        now = 0xffffff00;
+        espbase::scheduler s(cycles);
+
+        unsigned runs = 0;
+        s.add("task", 100, 0, [&]{ ++runs; });
+
+        for (; now != 0x400; ++now)
+            s.run();
+
+        assert(runs == 13);
+    });
+
+    return 0;
+}
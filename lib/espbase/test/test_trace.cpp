@@ -0,0 +1,124 @@
+#include <cassert>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "test.h"
+
+#include "../src/trace.hpp"
+
+static uint32_t now;
+uint32_t espbase::cycles() { return now; }
+
+espbase::trace espbase::tracer(4);
+
+template<class T>
+static T take(std::vector<uint8_t> const& data, size_t& pos) {
+    T value;
+    std::memcpy(&value, &data[pos], sizeof(T));
+    pos += sizeof(T);
+    return value;
+}
+
+static std::string take_string(std::vector<uint8_t> const& data, size_t& pos) {
+    std::string s(reinterpret_cast<const char *>(&data[pos]));
+    pos += s.size() + 1;
+    return s;
+}
+
+int main() {
+    using espbase::tracer;
+
+    test("record", []{
+        now = 100;
+        tracer.record(espbase::trace_wifi_up);
+        now = 200;
+        tracer.record(espbase::trace_user, 7);
+
+        assert(tracer.size() == 2);
+        assert(tracer[0].cycles == 100 && tracer[0].event == espbase::trace_wifi_up && tracer[0].arg == 0);
+        assert(tracer[1].cycles == 200 && tracer[1].event == espbase::trace_user && tracer[1].arg == 7);
+        assert(tracer.lost() == 0);
+        tracer.clear();
+    });
+
+    test("overwrites_oldest", []{
+        for (uint16_t i = 0; i < 6; ++i)
+            tracer.record(espbase::trace_user, i);
+
+        assert(tracer.size() == tracer.max_size());
+        assert(tracer.lost() == 2);
+        assert(tracer[0].arg == 2);
+        assert(tracer[3].arg == 5);
+        tracer.clear();
+        assert(tracer.size() == 0 && tracer.lost() == 0);
+    });
+
+    test("scope", []{
+        {
+            espbase::trace_scope t(tracer, espbase::trace_user, espbase::trace_user + 1, 3);
+            now += 50;
+        }
+
+        assert(tracer.size() == 2);
+        assert(tracer[0].event == espbase::trace_user);
+        assert(tracer[1].event == espbase::trace_user + 1);
+        assert(tracer[1].cycles - tracer[0].cycles == 50);
+        assert(tracer[1].arg == 3);
+        tracer.clear();
+    });
+
+    test("dump", []{
+        tracer.name(espbase::trace_command, "command");
+        tracer.name(espbase::trace_user, "isr");
+
+        now = 1000;
+        tracer.record(espbase::trace_command, 1);
+        now = 1080;
+        tracer.record(espbase::trace_user);
+
+        const espbase::trace::label labels[] = {{espbase::trace_command, 1, "on"}};
+        std::vector<uint8_t> out;
+        uint32_t writes = 0;
+
+        tracer.dump([&](const void *data, size_t size) {
+            writes++;
+            // recorded meanwhile, e.g. by an ISR
+            tracer.record(espbase::trace_user);
+            auto *p = static_cast<const uint8_t *>(data);
+            out.insert(out.end(), p, p + size);
+        }, 80000000, labels, 1);
+
+        size_t pos = 0;
+        assert(std::memcmp(out.data(), "TRC1", 4) == 0);
+        pos += 4;
+        assert(take<uint32_t>(out, pos) == 80000000);
+        assert(take<uint32_t>(out, pos) == 2);
+        assert(take<uint32_t>(out, pos) == 0);
+        assert(take<uint16_t>(out, pos) == 2);
+        assert(take<uint16_t>(out, pos) == 1);
+
+        assert(take<uint8_t>(out, pos) == espbase::trace_command);
+        assert(take_string(out, pos) == "command");
+        assert(take<uint8_t>(out, pos) == espbase::trace_user);
+        assert(take_string(out, pos) == "isr");
+
+        assert(take<uint8_t>(out, pos) == espbase::trace_command);
+        assert(take<uint16_t>(out, pos) == 1);
+        assert(take_string(out, pos) == "on");
+
+        auto a = take<espbase::trace::entry>(out, pos);
+        auto b = take<espbase::trace::entry>(out, pos);
+        assert(a.cycles == 1000 && a.event == espbase::trace_command && a.arg == 1);
+        assert(b.cycles == 1080 && b.event == espbase::trace_user);
+        assert(pos == out.size());
+
+        // cleared, events recorded while dumping are lost
+        assert(tracer.size() == 0);
+        assert(tracer.lost() == writes);
+        tracer.record(espbase::trace_user);
+        assert(tracer.size() == 1);
+    });
+
+    return 0;
+}
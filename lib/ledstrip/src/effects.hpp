@@ -0,0 +1,116 @@
+#pragma once
+
+#include <tuple>
+
+#include "render.hpp"
+
+namespace ledstrip {
+namespace effect {
+
+// min of two travelling waves
+struct waves {
+    static constexpr const char *name = "waves";
+
+    inline waves(frame_params const& p, phase_lut const& lut):
+        m_lut(lut),
+        m_phase{p.phase[0], p.phase[1]},
+        m_step{p.step[0], p.step[1]}
+    { }
+
+    inline uint32_t operator()() {
+        uint32_t f0 = m_lut(m_phase[0]);
+        uint32_t f1 = m_lut(m_phase[1]);
+        m_phase[0] += m_step[0];
+        m_phase[1] += m_step[1];
+        return (f0 < f1 ? f0 : f1) + 1;
+    }
+
+private:
+    phase_lut const& m_lut;
+    uint32_t m_phase[2];
+    uint32_t m_step[2];
+};
+
+// waves with a third, slower and wider one
+struct waves3 {
+    static constexpr const char *name = "waves3";
+
+    inline waves3(frame_params const& p, phase_lut const& lut):
+        m_waves(p, lut),
+        m_lut(lut),
+        m_phase(p.phase[2]),
+        m_step(p.step[2])
+    { }
+
+    inline uint32_t operator()() {
+        uint32_t f01 = m_waves();
+        uint32_t f2 = m_lut(m_phase) + 1;
+        m_phase += m_step;
+        return f01 < f2 ? f01 : f2;
+    }
+
+private:
+    waves m_waves;
+    phase_lut const& m_lut;
+    uint32_t m_phase;
+    uint32_t m_step;
+};
+
+// linear from the first to the last LED
+struct gradient {
+    static constexpr const char *name = "gradient";
+
+    inline gradient(frame_params const& p, phase_lut const&):
+        m_step(p.count > 1 ? 0x10000 / (p.count - 1) : 0)
+    { }
+
+    inline uint32_t operator()() {
+        uint32_t c = m_value < 0x10000 ? m_value : 0x10000;
+        m_value += m_step;
+        return c;
+    }
+
+private:
+    uint32_t m_step;
+    uint32_t m_value = 0;
+};
+
+// all LEDs at the ramp color
+struct solid {
+    static constexpr const char *name = "solid";
+
+    inline solid(frame_params const&, phase_lut const&) { }
+    inline uint32_t operator()() { return 0x10000; }
+};
+
+}
+
+// selected by index, out of range values fall back to the first one
+using effects = std::tuple<effect::waves, effect::waves3, effect::gradient, effect::solid>;
+
+static constexpr unsigned effect_count = std::tuple_size<effects>::value;
+
+template<unsigned N, unsigned I = 0>
+inline void render(unsigned effect, frame_params const& p, phase_lut const& lut,
+                   gamma_lut const& gamma, uint16_t (&color)[N][3]) {
+    if constexpr (I + 1 < effect_count) {
+        if (effect != I)
+            return render<N, I + 1>(effect, p, lut, gamma, color);
+    } else if (effect != I) {
+        return render<typename std::tuple_element<0, effects>::type>(p, lut, gamma, color);
+    }
+
+    render<typename std::tuple_element<I, effects>::type>(p, lut, gamma, color);
+}
+
+template<unsigned I = 0>
+inline const char *effect_name(unsigned effect) {
+    if constexpr (I < effect_count) {
+        if (effect == I)
+            return std::tuple_element<I, effects>::type::name;
+        return effect_name<I + 1>(effect);
+    }
+    return nullptr;
+}
+
+}
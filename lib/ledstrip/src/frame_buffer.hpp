@@ -0,0 +1,55 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace ledstrip {
+
+// Triple buffer between one writer (loop) and one reader (the timer ISR).
+// The writer fills back() and publish()es it, the reader acquire()s the most
+// recently published frame. Neither side ever waits for the other and the
+// reader never sees a frame that is still being written.
+template<class Frame>
+class frame_buffer {
+public:
+    inline Frame& back() { return m_frames[m_back]; }
+
+    inline void publish() {
+        uint8_t prev = m_ready.exchange(m_back | fresh);
+        m_back = prev & index;
+        m_published = m_published + 1;
+    }
+
+    // newest published frame, the previous one again if nothing new is ready
+    inline Frame const& acquire() {
+        if (m_ready.load() & fresh) {
+            uint8_t prev = m_ready.exchange(m_front);
+            m_front = prev & index;
+            m_consumed = m_consumed + 1;
+        }
+        return m_frames[m_front];
+    }
+
+    inline Frame const& front() const { return m_frames[m_front]; }
+
+    // a published frame is waiting to be acquired
+    inline bool pending() const { return m_ready.load() & fresh; }
+
+    inline uint32_t published() const { return m_published; }
+    inline uint32_t consumed() const { return m_consumed; }
+
+private:
+    static constexpr uint8_t index = 0x03;
+    static constexpr uint8_t fresh = 0x80;
+
+    Frame m_frames[3] = {};
+    uint8_t m_back = 0;
+    uint8_t m_front = 1;
+    std::atomic<uint8_t> m_ready = {2};
+
+    // each written from one side only
+    volatile uint32_t m_published = 0;
+    volatile uint32_t m_consumed = 0;
+};
+
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+
+namespace ledstrip {
+
+// Renders frames at the rate the output consumes them instead of on every
+// loop() pass. Each frame is stamped with the time it is expected on the
+// strip, one interval after the previous one; a frame is due once its
+// target is at most one interval away and the output took the last one.
+// Targets that already passed when loop() gets around to them count as
+// dropped.
+class frame_pacer {
+public:
+    frame_pacer(uint32_t interval): m_interval(interval) { }
+
+    inline void set_interval(uint32_t interval) { m_interval = interval ? interval : 1; }
+
+    // output is not taking frames, the next due() starts over from its now
+    inline void stop() { m_running = false; }
+
+    // pending: the previously rendered frame was not consumed yet
+    inline bool due(uint32_t now, bool pending) {
+        if (!m_running) {
+            // a frame left pending from before is stale, overwrite it
+            m_target = now + m_interval;
+            m_running = true;
+        } else if (pending || int32_t(m_target - now) > int32_t(m_interval)) {
+            return false;
+        } else if (int32_t(now - m_target) >= 0) {
+            uint32_t missed = (now - m_target) / m_interval + 1;
+            m_dropped = m_dropped + missed;
+            m_target += missed * m_interval;
+        }
+
+        m_stamp = m_target;
+        m_target += m_interval;
+        m_rendered = m_rendered + 1;
+        return true;
+    }
+
+    // target time of the frame due() last returned true for
+    inline uint32_t target() const { return m_stamp; }
+
+    inline uint32_t rendered() const { return m_rendered; }
+    inline uint32_t dropped() const { return m_dropped; }
+
+private:
+    uint32_t m_interval;
+    uint32_t m_target = 0;
+    uint32_t m_stamp = 0;
+    bool m_running = false;
+    volatile uint32_t m_rendered = 0;
+    volatile uint32_t m_dropped = 0;
+};
+
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstdint>
+
+#include <histogram.hpp>
+
+namespace ledstrip {
+
+// Picks the output timer interval from what the ISR actually costs: the
+// requested interval unless the ISR would take more than its share of the
+// CPU, backing off further while interrupts arrive late (overruns). The ISR
+// reports every run with sample(), loop() calls update() periodically.
+class rate_controller {
+public:
+    enum reason : uint8_t {
+        requested,      // led_update_freq as configured
+        isr_share,      // slowest recent ISR run over its CPU share
+        overruns,       // backing off after late interrupts
+        timer_limit,    // longest interval timer1 can do
+    };
+
+    static constexpr const char *reason_name(reason r) {
+        return r == requested ? "requested" :
+               r == isr_share ? "isr share" :
+               r == overruns  ? "overruns" :
+                                "timer limit";
+    }
+
+    // handle_time: cycles the ISR took, overrun: it ran late
+    inline void sample(uint32_t handle_time, bool overrun) {
+        m_handle_time.record(handle_time);
+        if (handle_time > m_window_max)
+            m_window_max = handle_time;
+        if (overrun)
+            m_window_overruns = m_window_overruns + 1;
+    }
+
+    // a late interrupt that did not send anything
+    inline void overrun() { m_window_overruns = m_window_overruns + 1; }
+
+    // share: percent of the CPU the ISR may use, returns the new interval
+    uint32_t update(uint32_t requested_interval, uint8_t share, uint32_t max_interval) {
+        uint32_t window_max = m_window_max;
+        uint32_t window_overruns = m_window_overruns;
+        m_window_max = 0;
+        m_window_overruns = 0;
+        m_overruns += window_overruns;
+
+        // the last window without ISR runs (e.g. all frames skipped) keeps
+        // the previous floor
+        if (window_max)
+            m_floor = uint64_t(window_max) * 100 / (share ? share : 1);
+
+        // doubles while interrupts run late, decays by a quarter otherwise
+        if (window_overruns) {
+            m_backoff = !m_backoff ? (m_interval ? m_interval : requested_interval) / 8 :
+                        m_backoff < max_interval ? m_backoff * 2 : max_interval;
+        } else {
+            m_backoff = m_backoff < 4 ? 0 : m_backoff - m_backoff / 4;
+        }
+
+        m_reason = requested;
+        uint64_t interval = requested_interval;
+
+        if (interval < m_floor) {
+            interval = m_floor;
+            m_reason = isr_share;
+        }
+
+        if (m_backoff) {
+            interval += m_backoff;
+            m_reason = overruns;
+        }
+
+        if (interval > max_interval) {
+            interval = max_interval;
+            m_reason = timer_limit;
+        }
+
+        m_interval = interval;
+        return m_interval;
+    }
+
+    inline void reset() {
+        m_handle_time.reset();
+        m_window_max = 0;
+        m_window_overruns = 0;
+        m_floor = 0;
+        m_backoff = 0;
+    }
+
+    inline uint32_t interval() const { return m_interval; }
+    inline reason why() const { return m_reason; }
+    inline uint32_t overrun_count() const { return m_overruns + m_window_overruns; }
+    inline espbase::histogram<24> const& handle_time() const { return m_handle_time; }
+
+private:
+    espbase::histogram<24> m_handle_time;
+    volatile uint32_t m_window_max = 0;
+    volatile uint32_t m_window_overruns = 0;
+
+    uint32_t m_overruns = 0;
+    uint32_t m_floor = 0;
+    uint32_t m_backoff = 0;
+    uint32_t m_interval = 0;
+    reason m_reason = requested;
+};
+
+}
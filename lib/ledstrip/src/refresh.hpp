@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdint>
+
+namespace ledstrip {
+
+// Decides on every output tick whether the strip needs data: when a new
+// frame is ready, otherwise only every keepalive cycles, so a glitched
+// strip recovers without resending a static frame at the full rate.
+class refresh_policy {
+public:
+    refresh_policy(uint32_t keepalive): m_keepalive(keepalive) { }
+
+    inline bool due(uint32_t now, bool fresh) {
+        if (fresh || now - m_last >= m_keepalive) {
+            m_last = now;
+            m_sent = m_sent + 1;
+            return true;
+        }
+
+        m_skipped = m_skipped + 1;
+        return false;
+    }
+
+    inline uint32_t sent() const { return m_sent; }
+    inline uint32_t skipped() const { return m_skipped; }
+
+private:
+    uint32_t m_keepalive;
+    uint32_t m_last = 0;
+    volatile uint32_t m_sent = 0;
+    volatile uint32_t m_skipped = 0;
+};
+
+}
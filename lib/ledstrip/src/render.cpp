@@ -0,0 +1,126 @@
+#include <algorithm>
+#include <cmath>
+
+#include "render.hpp"
+
+static constexpr double pi = 3.1415926535897932384626433832795;
+
+// fractional part of num / den as Q32 turns, den < 2^32
+static inline uint32_t to_turns(uint64_t num, uint32_t den) {
+    return (uint64_t(num % den) << 32) / den;
+}
+
+ledstrip::phase_lut::phase_lut() {
+    // sqrt(sin(x) * 0.5 + 0.5) == |cos(x / 2 - pi / 4)|
+    for (unsigned i = 0; i <= size; ++i)
+        m_table[i] = std::lround(std::fabs(std::cos(pi * i / size - pi / 4)) * 0xffff);
+}
+
+// min(2.5 t, 1), t, min(t < 0.5 ? 0.5 t : 1.5 t - 0.5, 1)
+const uint16_t ledstrip::color_ramp::default_keyframes[max_keyframes * 4] = {
+    0x0000, 0x0000, 0x0000, 0x0000,
+    0x6666, 0xffff, 0x6666, 0x3333,
+    0x8000, 0xffff, 0x8000, 0x4000,
+    0xffff, 0xffff, 0xffff, 0xffff,
+};
+
+void ledstrip::color_ramp::build(const uint16_t (&keyframes)[max_keyframes * 4]) {
+    const uint16_t *k = keyframes[0] == 0 ? keyframes : default_keyframes;
+
+    m_size = 1;
+    while (m_size < max_keyframes && k[m_size * 4] > k[(m_size - 1) * 4])
+        ++m_size;
+
+    for (unsigned i = 0; i < m_size; ++i) {
+        auto& s = m_segments[i];
+        s.start = k[i * 4];
+
+        for (unsigned j = 0; j < 3; ++j) {
+            s.color[j] = k[i * 4 + 1 + j];
+
+            // last keyframe holds its color
+            s.slope[j] = i + 1 < m_size
+                ? (int64_t(k[(i + 1) * 4 + 1 + j]) - s.color[j]) * 0x10000 / (k[(i + 1) * 4] - s.start)
+                : 0;
+        }
+    }
+}
+
+void ledstrip::color_ramp::operator()(uint16_t progression, uint16_t (&color)[3]) const {
+    unsigned i = m_size - 1;
+    while (i > 0 && progression < m_segments[i].start)
+        --i;
+
+    auto& s = m_segments[i];
+    int64_t dt = progression - s.start;
+
+    for (unsigned j = 0; j < 3; ++j) {
+        int64_t c = s.color[j] + (s.slope[j] * dt >> 16);
+        color[j] = c < 0 ? 0 : c > 0xffff ? 0xffff : c;
+    }
+}
+
+ledstrip::frame_params ledstrip::prepare(render_input const& in, color_ramp const& ramp) {
+    frame_params p = {};
+
+    // wave speed in turns per second at animation_speed 0x0100: sign / den
+    static const struct { uint8_t frequency; int8_t sign; uint8_t den; } waves[frame_params::waves] = {
+        {5, -1, 25},
+        {11, 1, 10},
+        {2, -1, 2},
+    };
+
+    uint64_t st = uint64_t(in.t_ms) * in.animation_speed;  // 1/256 ms
+
+    for (unsigned i = 0; i < frame_params::waves; ++i) {
+        uint32_t phase = to_turns(st, 0x0100 * 1000 * waves[i].den);
+        p.phase[i] = waves[i].sign < 0 ? -phase : phase;
+
+        if (in.led_count)
+            p.step[i] = (uint64_t(waves[i].frequency * in.variation) << 24) / in.led_count;
+    }
+
+    // twice the fraction of duration elapsed, 0xffff ~ 1.0
+    uint32_t period = uint32_t(in.duration) * 1000;
+    uint32_t progression = period ? uint64_t(in.t_ms % period) * 2 * 0xffff / period : 0;
+    ramp(std::min<uint32_t>({progression, in.max_progression, 0xffff}), p.scale);
+
+    p.count = in.led_count;
+    return p;
+}
+
+void ledstrip::gamma_lut::build(uint8_t brightness, float gamma) {
+    for (unsigned i = 0; i <= size; ++i)
+        m_table[i] = std::lround(brightness * 0x100 * std::pow(float(i) / size, gamma));
+}
+
+void ledstrip::render_float(render_input const& in, uint8_t brightness, uint16_t (*color)[3], unsigned num_leds) {
+    double t = in.t_ms / 1000.0;
+    float st = t * in.animation_speed / 0x0100;
+    float _, t10 = std::min(std::modf(float(t / in.duration), &_) * 2.0f, in.max_progression / 65535.0f);
+
+    for (unsigned i = 0; i < in.led_count && i < num_leds; ++i) {
+        float x = float(i) / in.led_count * in.variation / 0x0100;
+
+        float f2 = std::sqrt(float(std::sin(float(2 * pi * (x * 5 - st * 0.04))) * 0.5 + 0.5));
+        float f3 = std::sqrt(float(std::sin(float(2 * pi * (x * 11 + st * 0.1))) * 0.5 + 0.5));
+
+        float c = std::min(f2, f3);
+
+        if (c < 0)
+            c = 0;
+        else if (c > 1)
+            c = 1;
+
+        float r = brightness * c * std::min(2.5f * t10, 1.0f);
+        float g = brightness * c * t10;
+        float b = brightness * c * std::min(t10 < 0.5f ? 0.5f * t10 : 1.5f * t10 - 0.5f, 1.0f);
+
+        color[i][0] = r * 0x100;
+        color[i][1] = g * 0x100;
+        color[i][2] = b * 0x100;
+    }
+
+    for (unsigned i = in.led_count; i < num_leds; ++i)
+        color[i][0] = color[i][1] = color[i][2] = 0x0000;
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <cstdint>
+
+namespace ledstrip {
+
+// sqrt(sin(2 pi x) * 0.5 + 0.5) over one turn, 0xffff ~ 1.0
+class phase_lut {
+public:
+    static constexpr unsigned bits = 10;
+    static constexpr unsigned size = 1 << bits;
+
+    phase_lut();
+
+    // phase: Q32 turns
+    inline uint16_t operator()(uint32_t phase) const {
+        uint32_t idx = phase >> (32 - bits);
+        int32_t frac = (phase >> (16 - bits)) & 0xffff;
+        int32_t a = m_table[idx];
+        int32_t b = m_table[idx + 1];
+        return a + ((b - a) * frac >> 16);
+    }
+
+private:
+    uint16_t m_table[size + 1];
+};
+
+// intensity (0xffff ~ 1.0) to 8.8 channel value: brightness * intensity ^ gamma
+class gamma_lut {
+public:
+    static constexpr unsigned bits = 8;
+    static constexpr unsigned size = 1 << bits;
+
+    void build(uint8_t brightness, float gamma);
+
+    inline uint16_t operator()(uint16_t intensity) const {
+        uint32_t idx = intensity >> (16 - bits);
+        int32_t frac = intensity & ((1 << (16 - bits)) - 1);
+        int32_t a = m_table[idx];
+        int32_t b = m_table[idx + 1];
+        return a + ((b - a) * frac >> (16 - bits));
+    }
+
+private:
+    uint16_t m_table[size + 1] = {};
+};
+
+// piecewise linear sunrise color over progression, 0xffff ~ 1.0
+class color_ramp {
+public:
+    static constexpr unsigned max_keyframes = 8;
+
+    color_ramp() { build(default_keyframes); }
+
+    // keyframes as (time, r, g, b), times strictly increasing from 0, ends at
+    // the first one that is not, falls back to the default without a first
+    // keyframe at 0 (e.g. erased config)
+    void build(const uint16_t (&keyframes)[max_keyframes * 4]);
+
+    void operator()(uint16_t progression, uint16_t (&color)[3]) const;
+
+    inline unsigned size() const { return m_size; }
+
+    static const uint16_t default_keyframes[max_keyframes * 4];
+
+private:
+    struct segment {
+        uint16_t start;
+        uint16_t color[3];
+        int64_t slope[3];  // color per progression, Q16
+    };
+
+    segment m_segments[max_keyframes];
+    uint8_t m_size;
+};
+
+// what calc_colors() reads from the clock and config for one frame
+struct render_input {
+    uint32_t t_ms;                // since the animation started
+    uint16_t max_progression;     // 0xffff ~ 1.0
+    uint16_t animation_speed;
+    uint16_t duration;
+    uint16_t variation;
+    uint8_t led_count;
+};
+
+struct frame_params {
+    static constexpr unsigned waves = 3;
+    uint32_t phase[waves];  // wave phase at the first LED, Q32 turns
+    uint32_t step[waves];   // phase increment per LED, Q32 turns
+    uint16_t scale[3];      // ramp per channel, 0xffff ~ 1.0
+    uint8_t count;
+};
+
+frame_params prepare(render_input const& in, color_ramp const& ramp);
+
+// Effect is constructed once per frame and called once per LED for its
+// intensity, 0 to 0x10000, see effects.hpp.
+template<class Effect, unsigned N>
+void render(frame_params const& p, phase_lut const& lut, gamma_lut const& gamma,
+            uint16_t (&color)[N][3]) {
+    Effect effect(p, lut);
+    unsigned count = p.count < N ? p.count : N;
+
+    for (unsigned i = 0; i < count; ++i) {
+        uint32_t c = effect();
+
+        // (c / 0x10000) * scale, c <= 0x10000 and scale < 0x10000
+        color[i][0] = gamma(c * p.scale[0] >> 16);
+        color[i][1] = gamma(c * p.scale[1] >> 16);
+        color[i][2] = gamma(c * p.scale[2] >> 16);
+    }
+
+    for (unsigned i = count; i < N; ++i)
+        color[i][0] = color[i][1] = color[i][2] = 0x0000;
+}
+
+// reference float implementation of the linear (gamma 1.0) path, kept for
+// comparison with render<effect::waves>()
+void render_float(render_input const& in, uint8_t brightness, uint16_t (*color)[3], unsigned num_leds);
+
+}
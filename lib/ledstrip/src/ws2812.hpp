@@ -0,0 +1,150 @@
+#pragma once
+
+#include <cstdint>
+
+#ifndef F_CPU
+#define F_CPU 80000000L
+#endif
+
+namespace ledstrip {
+namespace ws2812 {
+
+constexpr uint32_t ns_to_cycles(uint32_t ns) { return ns * (F_CPU / 1000000) / 1000; }
+
+static constexpr unsigned t0_hi_ns = 400;
+static constexpr unsigned t1_hi_ns = 800;
+static constexpr unsigned bit_period_ns = 1250;
+static constexpr unsigned tolerance_ns = 150;
+
+static constexpr unsigned reset_time = ns_to_cycles(500000);
+// the shortest low time that latches a strip (older parts, newer ones
+// need 280 us); a gap up to here keeps a frame going
+static constexpr unsigned latch_us = 50;
+static constexpr unsigned t0_hi = ns_to_cycles(t0_hi_ns);
+static constexpr unsigned t0_lo = ns_to_cycles(bit_period_ns - t0_hi_ns);
+
+static constexpr unsigned t1_hi = ns_to_cycles(t1_hi_ns);
+static constexpr unsigned t1_lo = ns_to_cycles(bit_period_ns - t1_hi_ns);
+
+static constexpr unsigned bit_period = t0_hi + t0_lo;
+static_assert(t1_hi + t1_lo == bit_period, "bit period must not depend on the value");
+static_assert(t1_hi < 0x100, "high times are stored as uint8_t");
+
+// UART backend: inverted TX at four UART bits per WS2812 bit, 6N1. Each UART
+// frame carries two WS2812 bits: the start bit and d3 are the leading high
+// slot of each, the stop bit the trailing low slot of the second. A 0 is
+// one high slot (312.5 ns), a 1 three (937.5 ns).
+static constexpr uint32_t uart_baud = 4 * 1000000000ull / bit_period_ns;
+static constexpr uint8_t uart_lut[4] = {0b110111, 0b000111, 0b110100, 0b000100};
+
+// on the wire for size bytes of UART data: start, 6 data and stop bit each
+constexpr uint32_t uart_cycles(uint32_t size) { return uint64_t(size) * 8 * F_CPU / uart_baud; }
+
+enum class format : uint8_t {
+    bitbang,    // high time in cycles of every bit
+    uart,       // 6N1 UART data bytes
+};
+
+// Strip data ready for transmission, GRB, MSB first.
+template<unsigned N>
+struct bitstream {
+    static constexpr unsigned bits_per_led = 24;
+    uint8_t data[N * bits_per_led];
+    uint16_t size;
+    uint32_t target;  // when it should be on the strip, cycles
+
+    // bitbang format only
+    inline const uint8_t *led(unsigned i) const { return &data[i * bits_per_led]; }
+};
+
+inline void expand(uint32_t grb, uint8_t *high) {
+    for (unsigned i = 0; i < 24; ++i) {
+        high[i] = (grb & 0x800000) ? t1_hi : t0_hi;
+        grb <<= 1;
+    }
+}
+
+inline void expand_uart(uint32_t grb, uint8_t *out) {
+    for (unsigned i = 0; i < 12; ++i) {
+        out[i] = uart_lut[(grb >> 22) & 0x3];
+        grb <<= 2;
+    }
+}
+
+// One dark LED in both formats. A blank strip is this N times, sent from
+// a loop so it needs no frame buffer of its own.
+struct dark_led {
+    uint8_t bitbang[24];
+    uint8_t uart[12];
+
+    dark_led() {
+        expand(0x000000, bitbang);
+        expand_uart(0x000000, uart);
+    }
+};
+
+// Dithers a frame of 8.8 RGB colors down to 8 bits and expands it to
+// a bitstream. Runs in loop(), the ISR only streams the result.
+//
+// The dither is a first-order sigma-delta per channel: the fraction that
+// did not make it into a frame is carried into the next one, so the
+// average over frames matches the 8.8 value.
+//
+// Returns whether the frame differs from the previous one, in value or
+// format, i.e. whether it needs to be sent at all.
+template<unsigned N>
+class encoder {
+public:
+    bool encode(uint16_t const (&color)[N][3], uint8_t dither_max, format fmt, bitstream<N>& out) {
+        bool changed = fmt != m_format;
+        m_format = fmt;
+        m_dithering = false;
+
+        for (unsigned i = 0; i < N; ++i) {
+            uint8_t rgb[3];
+
+            for (unsigned j = 0; j < 3; ++j) {
+                rgb[j] = color[i][j] >> 8;
+                uint8_t fract = uint16_t(color[i][j] & 0xff) * dither_max >> 8;
+
+                uint16_t acc = m_error[i][j] + fract;
+                m_error[i][j] = acc;
+                m_dithering |= fract && rgb[j] < 0xff;
+
+                if (acc > 0xff && rgb[j] < 0xff)
+                    rgb[j] += 1;
+            }
+
+            uint32_t grb = rgb[0] << 8 | rgb[1] << 16 | rgb[2];
+            changed |= grb != m_last[i];
+            m_last[i] = grb;
+
+            put(fmt, i, grb, out);
+        }
+
+        out.size = size(fmt);
+        return changed;
+    }
+
+    // whether the last frame had fractions left to dither
+    inline bool dithering() const { return m_dithering; }
+
+private:
+    static constexpr uint16_t size(format fmt) {
+        return (fmt == format::uart) ? N * 12 : N * 24; }
+
+    static inline void put(format fmt, unsigned i, uint32_t grb, bitstream<N>& out) {
+        if (fmt == format::uart)
+            expand_uart(grb, &out.data[i * 12]);
+        else
+            expand(grb, &out.data[i * 24]);
+    }
+
+    uint8_t m_error[N][3] = {};
+    uint32_t m_last[N] = {};
+    format m_format = format::bitbang;
+    bool m_dithering = false;
+};
+
+}
+}
@@ -0,0 +1,34 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <chrono>
+#include <cstdio>
+
+// runs func() until min_time has passed and prints the time per call
+template<class Func>
+double bench(const char* name, Func func, double min_time = 0.2) {
+    using clock = std::chrono::steady_clock;
+
+    unsigned long iterations = 0;
+    auto start = clock::now();
+    std::chrono::duration<double> elapsed;
+
+    do {
+        for (unsigned i = 0; i < 64; ++i)
+            func();
+        iterations += 64;
+        elapsed = clock::now() - start;
+    } while (elapsed.count() < min_time);
+
+    double ns = elapsed.count() * 1e9 / iterations;
+    std::printf("%-32s %12.1f ns\n", name, ns);
+    return ns;
+}
+
+// keeps the compiler from optimizing away a result
+template<class T>
+inline void do_not_optimize(T const& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+#endif
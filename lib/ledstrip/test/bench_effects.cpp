@@ -0,0 +1,75 @@
+#include <cassert>
+#include <cstdio>
+#include <tuple>
+
+#include "bench.h"
+
+#include "../src/effects.hpp"
+#include "../src/render.cpp"
+
+const unsigned NUM_LEDS = 60;
+
+static ledstrip::phase_lut lut;
+static ledstrip::gamma_lut gamma_lut;
+static ledstrip::color_ramp ramp;
+
+static uint16_t out[NUM_LEDS][3];
+
+template<unsigned I = 0>
+void bench_effects(ledstrip::frame_params const& p) {
+    if constexpr (I < ledstrip::effect_count) {
+        using effect = typename std::tuple_element<I, ledstrip::effects>::type;
+
+        bench(effect::name, [&]{
+            ledstrip::render<effect>(p, lut, gamma_lut, out);
+            do_not_optimize(out);
+        });
+
+        // values stay in range of the gamma LUT
+        for (unsigned i = 0; i < NUM_LEDS; ++i)
+            for (unsigned j = 0; j < 3; ++j)
+                assert(out[i][j] <= 0xff00);
+
+        bench_effects<I + 1>(p);
+    }
+}
+
+int main() {
+    ledstrip::render_input in = {
+        .t_ms = 1234500,
+        .max_progression = 0xffff,
+        .animation_speed = 0x0100,
+        .duration = 90 * 60,
+        .variation = 0x0100,
+        .led_count = NUM_LEDS,
+    };
+
+    gamma_lut.build(255, 2.2f);
+    auto p = ledstrip::prepare(in, ramp);
+
+    // host time says nothing about the ESP8266's frame budget, on the
+    // device 'perf calc_colors' has the cycles
+    std::printf("host ns/frame, %u LEDs\n", NUM_LEDS);
+    bench_effects(p);
+
+    // runtime dispatch matches the directly instantiated effect
+    uint16_t ref[NUM_LEDS][3];
+    for (unsigned e = 0; e < ledstrip::effect_count + 2; ++e) {
+        ledstrip::render(e, p, lut, gamma_lut, out);
+        if (e == 2)
+            ledstrip::render<ledstrip::effect::gradient>(p, lut, gamma_lut, ref);
+        else if (e == 0 || e >= ledstrip::effect_count)
+            ledstrip::render<ledstrip::effect::waves>(p, lut, gamma_lut, ref);
+        else
+            continue;
+
+        for (unsigned i = 0; i < NUM_LEDS; ++i)
+            for (unsigned j = 0; j < 3; ++j)
+                assert(out[i][j] == ref[i][j]);
+    }
+
+    assert(ledstrip::effect_name(0) != nullptr);
+    assert(ledstrip::effect_name(ledstrip::effect_count) == nullptr);
+
+    return 0;
+}
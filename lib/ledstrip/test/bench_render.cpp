@@ -0,0 +1,73 @@
+#include <cassert>
+#include <cstdlib>
+
+#include "bench.h"
+
+#include "../src/effects.hpp"
+#include "../src/render.hpp"
+#include "../src/render.cpp"
+
+const unsigned NUM_LEDS = 60;
+
+static ledstrip::phase_lut lut;
+static ledstrip::gamma_lut gamma_lut;
+static ledstrip::color_ramp ramp;
+
+int main() {
+    uint16_t ref[NUM_LEDS][3];
+    uint16_t out[NUM_LEDS][3];
+
+    ledstrip::render_input in = {
+        .t_ms = 0,
+        .max_progression = 0xffff,
+        .animation_speed = 0x0100,
+        .duration = 90 * 60,
+        .variation = 0x0100,
+        .led_count = NUM_LEDS,
+    };
+
+    // compare both paths over a whole sunrise, at day and night brightness
+    int max_err = 0, max_err_fract = 0;
+    unsigned frames = 0;
+
+    for (uint8_t brightness : {255, 10}) {
+        gamma_lut.build(brightness, 1.0f);
+
+        for (in.t_ms = 0; in.t_ms < in.duration * 1000u; in.t_ms += 370) {
+            ledstrip::render_float(in, brightness, ref, NUM_LEDS);
+            ledstrip::render<ledstrip::effect::waves>(ledstrip::prepare(in, ramp), lut, gamma_lut, out);
+            ++frames;
+
+            for (unsigned i = 0; i < NUM_LEDS; ++i) {
+                for (unsigned j = 0; j < 3; ++j) {
+                    int err = std::abs(int(out[i][j] >> 8) - int(ref[i][j] >> 8));
+                    max_err = std::max(max_err, err);
+
+                    err = std::abs(int(out[i][j]) - int(ref[i][j]));
+                    max_err_fract = std::max(max_err_fract, err);
+                }
+            }
+        }
+    }
+
+    std::printf("frames compared: %u, max error: %d LSB (8.8: %d)\n", frames, max_err, max_err_fract);
+    assert(max_err <= 1);
+
+    in.t_ms = 1234500;
+    uint8_t brightness = 255;
+    gamma_lut.build(brightness, 1.0f);
+
+    double t_float = bench("render_float", [&]{
+        ledstrip::render_float(in, brightness, ref, NUM_LEDS);
+        do_not_optimize(ref);
+    });
+
+    double t_fixed = bench("prepare + render", [&]{
+        ledstrip::render<ledstrip::effect::waves>(ledstrip::prepare(in, ramp), lut, gamma_lut, out);
+        do_not_optimize(out);
+    });
+
+    std::printf("speedup: %.1fx\n", t_float / t_fixed);
+
+    return 0;
+}
@@ -0,0 +1,74 @@
+#include <thread>
+
+#include "test.h"
+
+#include "../src/frame_buffer.hpp"
+
+using frame = uint32_t[64];
+
+static void fill(frame& f, uint32_t value) {
+    for (auto& v : f)
+        v = value;
+}
+
+static bool is_complete(frame const& f) {
+    for (auto v : f)
+        if (v != f[0])
+            return false;
+    return true;
+}
+
+int main() {
+    test("acquire_latest", []{
+        ledstrip::frame_buffer<frame> b;
+
+        fill(b.back(), 1); b.publish();
+        fill(b.back(), 2); b.publish();
+        fill(b.back(), 3); b.publish();
+
+        assert(b.acquire()[0] == 3);
+        assert(b.published() == 3);
+        assert(b.consumed() == 1);
+    });
+
+    test("acquire_without_publish", []{
+        ledstrip::frame_buffer<frame> b;
+
+        fill(b.back(), 1); b.publish();
+        assert(b.acquire()[0] == 1);
+        assert(b.acquire()[0] == 1);
+        assert(b.consumed() == 1);
+
+        // writing the back buffer never touches the front
+        fill(b.back(), 2);
+        assert(b.acquire()[0] == 1);
+        b.publish();
+        assert(b.acquire()[0] == 2);
+    });
+
+    test("no_torn_frames", []{
+        const uint32_t count = 200000;
+        ledstrip::frame_buffer<frame> b;
+
+        std::thread writer([&]{
+            for (uint32_t i = 1; i <= count; ++i) {
+                fill(b.back(), i);
+                b.publish();
+            }
+        });
+
+        uint32_t last = 0;
+        while (last < count) {
+            auto& f = b.acquire();
+            assert(is_complete(f));
+            assert(f[0] >= last);
+            last = f[0];
+        }
+
+        writer.join();
+        assert(b.published() == count);
+        assert(b.consumed() <= count);
+    });
+
+    return 0;
+}
@@ -0,0 +1,71 @@
+#include <cassert>
+
+#include "test.h"
+
+#include "../src/pacer.hpp"
+
+using ledstrip::frame_pacer;
+
+int main() {
+    test("one_frame_per_interval", []{
+        frame_pacer pacer(100);
+
+        assert(pacer.due(1000, false));
+        assert(pacer.target() == 1100);
+
+        // loop() spins much faster than the output
+        unsigned rendered = 1;
+        for (uint32_t now = 1001; now < 2000; ++now)
+            rendered += pacer.due(now, false);
+
+        assert(rendered == 10);
+        assert(pacer.dropped() == 0);
+    });
+
+    test("waits_for_consumer", []{
+        frame_pacer pacer(100);
+        assert(pacer.due(0, false));
+        assert(!pacer.due(150, true));
+        assert(pacer.due(150, false));
+        assert(pacer.target() == 200);
+    });
+
+    test("late_frames_dropped", []{
+        frame_pacer pacer(100);
+        assert(pacer.due(0, false));  // for 100
+
+        // loop() blocked past the 200 and 300 targets
+        assert(pacer.due(350, false));
+        assert(pacer.dropped() == 2);
+        assert(pacer.target() == 400);
+
+        assert(!pacer.due(350, false));
+        assert(pacer.due(400, false));
+        assert(pacer.target() == 500);
+        assert(pacer.dropped() == 2);
+    });
+
+    test("restart_after_stop", []{
+        frame_pacer pacer(100);
+        assert(pacer.due(0, false));
+
+        pacer.stop();
+        assert(pacer.due(1000000, true));
+        assert(pacer.target() == 1000100);
+        assert(pacer.dropped() == 0);
+    });
+
+    test("counter_wraparound", []{
+        frame_pacer pacer(100);
+        assert(pacer.due(0xffffff00, false));
+
+        unsigned rendered = 1;
+        for (uint32_t now = 0xffffff01; now != 0x2e8; ++now)
+            rendered += pacer.due(now, false);
+
+        assert(rendered == 10);
+        assert(pacer.dropped() == 0);
+    });
+
+    return 0;
+}
@@ -0,0 +1,63 @@
+#include <cassert>
+
+#include "test.h"
+
+#include "../src/rate_control.hpp"
+
+using ledstrip::rate_controller;
+
+static const uint32_t max_interval = (1 << 22) - 1;
+
+int main() {
+    test("requested_rate", []{
+        rate_controller c;
+        c.sample(10000, false);
+        assert(c.update(400000, 80, max_interval) == 400000);
+        assert(c.why() == rate_controller::requested);
+    });
+
+    test("isr_share_floor", []{
+        rate_controller c;
+        c.sample(300000, false);
+        c.sample(280000, false);
+
+        // 300000 cycles may be at most 80 % of the interval
+        assert(c.update(100000, 80, max_interval) == 375000);
+        assert(c.why() == rate_controller::isr_share);
+
+        // no runs in this window, the floor stays
+        assert(c.update(100000, 80, max_interval) == 375000);
+        assert(c.handle_time().total() == 2);
+        assert(c.handle_time().max() == 300000);
+    });
+
+    test("overrun_backoff", []{
+        rate_controller c;
+        c.sample(10000, true);
+        assert(c.update(400000, 80, max_interval) == 450000);
+        assert(c.why() == rate_controller::overruns);
+
+        c.sample(10000, true);
+        assert(c.update(400000, 80, max_interval) == 500000);
+
+        // recovers once interrupts are on time again
+        uint32_t interval = 0;
+        for (unsigned i = 0; i < 64; ++i) {
+            c.sample(10000, false);
+            interval = c.update(400000, 80, max_interval);
+        }
+
+        assert(interval == 400000);
+        assert(c.why() == rate_controller::requested);
+        assert(c.overrun_count() == 2);
+    });
+
+    test("timer_limit", []{
+        rate_controller c;
+        c.sample(max_interval, false);
+        assert(c.update(100000, 50, max_interval) == max_interval);
+        assert(c.why() == rate_controller::timer_limit);
+    });
+
+    return 0;
+}
@@ -0,0 +1,90 @@
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+
+#include "test.h"
+
+#include "../src/render.hpp"
+#include "../src/render.cpp"
+
+using ledstrip::color_ramp;
+
+static int max_error(color_ramp const& ramp, float (*ref)(float, unsigned)) {
+    int max_err = 0;
+
+    for (unsigned x = 0; x <= 0xffff; x += 7) {
+        uint16_t color[3];
+        ramp(x, color);
+
+        for (unsigned j = 0; j < 3; ++j) {
+            int expected = std::lround(ref(x / 65535.0f, j) * 0xffff);
+            max_err = std::max(max_err, std::abs(color[j] - expected));
+        }
+    }
+
+    return max_err;
+}
+
+static float original_ramp(float t10, unsigned channel) {
+    switch (channel) {
+    case 0: return std::min(2.5f * t10, 1.0f);
+    case 1: return t10;
+    default: return std::min(t10 < 0.5f ? 0.5f * t10 : 1.5f * t10 - 0.5f, 1.0f);
+    }
+}
+
+int main() {
+    test("default_matches_original", []{
+        color_ramp ramp;
+        assert(ramp.size() == 4);
+        assert(max_error(ramp, original_ramp) <= 2);
+    });
+
+    test("erased_falls_back_to_default", []{
+        uint16_t keyframes[color_ramp::max_keyframes * 4];
+        std::fill(std::begin(keyframes), std::end(keyframes), 0xffff);
+
+        color_ramp ramp;
+        ramp.build(keyframes);
+        assert(ramp.size() == 4);
+        assert(max_error(ramp, original_ramp) <= 2);
+    });
+
+    test("custom_keyframes", []{
+        // blue fades in, then everything goes white, padding ends the list
+        uint16_t keyframes[color_ramp::max_keyframes * 4] = {
+            0x0000, 0x0000, 0x0000, 0x0000,
+            0x4000, 0x0000, 0x0000, 0x8000,
+            0xc000, 0xffff, 0xffff, 0xffff,
+        };
+
+        color_ramp ramp;
+        ramp.build(keyframes);
+        assert(ramp.size() == 3);
+
+        uint16_t c[3];
+        ramp(0x2000, c);
+        assert(c[0] == 0 && c[1] == 0 && c[2] == 0x4000);
+
+        ramp(0x8000, c);
+        assert(c[0] == 0x7fff && c[1] == 0x7fff && std::abs(c[2] - 0xbfff) <= 1);
+
+        // holds the last keyframe
+        ramp(0xffff, c);
+        assert(c[0] == 0xffff && c[1] == 0xffff && c[2] == 0xffff);
+    });
+
+    test("single_keyframe", []{
+        uint16_t keyframes[color_ramp::max_keyframes * 4] = {0x0000, 0x1000, 0x2000, 0x3000};
+
+        color_ramp ramp;
+        ramp.build(keyframes);
+        assert(ramp.size() == 1);
+
+        uint16_t c[3];
+        ramp(0x9000, c);
+        assert(c[0] == 0x1000 && c[1] == 0x2000 && c[2] == 0x3000);
+    });
+
+    return 0;
+}
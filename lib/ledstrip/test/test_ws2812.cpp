@@ -0,0 +1,172 @@
+#include <algorithm>
+#include <cstdlib>
+#include <iterator>
+#include <vector>
+
+#include "test.h"
+
+#include "../src/ws2812.hpp"
+
+using namespace ledstrip::ws2812;
+
+static unsigned cycles_to_ns(unsigned cycles) {
+    return cycles * 1000 / (F_CPU / 1000000);
+}
+
+// line level of every UART bit time for 6N1 with inverted TX
+static std::vector<bool> uart_line(const uint8_t *data, unsigned size) {
+    std::vector<bool> line;
+    for (unsigned i = 0; i < size; ++i) {
+        line.push_back(true);                       // start bit
+        for (unsigned b = 0; b < 6; ++b)
+            line.push_back(!(data[i] >> b & 1));    // data, LSB first
+        line.push_back(false);                      // stop bit
+    }
+    return line;
+}
+
+struct pulse {
+    unsigned high_ns;
+    unsigned period_ns;
+};
+
+static std::vector<pulse> pulses(std::vector<bool> const& line, double slot_ns) {
+    std::vector<pulse> out;
+    unsigned i = 0;
+    while (i < line.size()) {
+        assert(line[i]);
+        unsigned start = i;
+        while (i < line.size() && line[i]) ++i;
+        unsigned high = i - start;
+        while (i < line.size() && !line[i]) ++i;
+        out.push_back({unsigned(high * slot_ns), unsigned((i - start) * slot_ns)});
+    }
+    return out;
+}
+
+static uint32_t decode(std::vector<pulse> const& p, unsigned first) {
+    uint32_t grb = 0;
+    for (unsigned i = first; i < first + 24; ++i) {
+        bool one = std::abs(int(p[i].high_ns) - int(cycles_to_ns(t1_hi))) <= tolerance_ns;
+        grb = grb << 1 | one;
+    }
+    return grb;
+}
+
+int main() {
+    test("bitbang_timing", []{
+        assert(std::abs(int(cycles_to_ns(t0_hi)) - int(t0_hi_ns)) < 25);
+        assert(std::abs(int(cycles_to_ns(t1_hi)) - int(t1_hi_ns)) < 25);
+        assert(cycles_to_ns(bit_period) == bit_period_ns);
+
+        uint8_t high[24];
+        expand(0xa5c30f, high);
+        for (unsigned i = 0; i < 24; ++i)
+            assert(high[i] == ((0xa5c30f >> (23 - i) & 1) ? t1_hi : t0_hi));
+    });
+
+    test("uart_waveform", []{
+        const double slot_ns = 1e9 / uart_baud;
+        const uint32_t values[] = {0x000000, 0xffffff, 0xa5c30f, 0x123456, 0x800001};
+
+        for (uint32_t grb : values) {
+            uint8_t data[12];
+            expand_uart(grb, data);
+
+            for (unsigned i = 0; i < 12; ++i)
+                assert(data[i] < 0x40);
+
+            auto p = pulses(uart_line(data, 12), slot_ns);
+            assert(p.size() == 24);
+
+            for (unsigned i = 0; i < 24; ++i) {
+                bool one = grb >> (23 - i) & 1;
+                unsigned expected = cycles_to_ns(one ? t1_hi : t0_hi);
+                assert(std::abs(int(p[i].high_ns) - int(expected)) <= int(tolerance_ns));
+                assert(std::abs(int(p[i].period_ns) - int(bit_period_ns)) <= int(tolerance_ns));
+            }
+
+            assert(decode(p, 0) == grb);
+        }
+    });
+
+    test("uart_cycles", []{
+        // 60 LEDs, 12 bytes each: 60 * 24 WS2812 bits
+        assert(cycles_to_ns(uart_cycles(60 * 12)) == 60 * 24 * bit_period_ns);
+    });
+
+    test("encoder_formats", []{
+        const unsigned N = 4;
+        uint16_t color[N][3] = {{0x1200, 0x3400, 0x5600}, {0xff00, 0, 0}, {0, 0xff00, 0}, {0, 0, 0xff00}};
+        const uint32_t grb[N] = {0x341256, 0x00ff00, 0xff0000, 0x0000ff};
+
+        encoder<N> bitbang_encoder;
+        bitstream<N> bits;
+        bitbang_encoder.encode(color, 0, format::bitbang, bits);
+        assert(bits.size == N * 24);
+
+        encoder<N> uart_encoder;
+        bitstream<N> bytes;
+        uart_encoder.encode(color, 0, format::uart, bytes);
+        assert(bytes.size == N * 12);
+
+        auto p = pulses(uart_line(bytes.data, bytes.size), 1e9 / uart_baud);
+
+        for (unsigned i = 0; i < N; ++i) {
+            assert(decode(p, i * 24) == grb[i]);
+            for (unsigned b = 0; b < 24; ++b)
+                assert(bits.led(i)[b] == ((grb[i] >> (23 - b) & 1) ? t1_hi : t0_hi));
+        }
+    });
+
+    test("dark_led", []{
+        const unsigned N = 2;
+        uint16_t color[N][3] = {};
+
+        encoder<N> e;
+        bitstream<N> bits, bytes;
+        e.encode(color, 0, format::bitbang, bits);
+        e.encode(color, 0, format::uart, bytes);
+
+        dark_led dark;
+        for (unsigned i = 0; i < N; ++i) {
+            assert(std::equal(dark.bitbang, std::end(dark.bitbang), bits.led(i)));
+            assert(std::equal(dark.uart, std::end(dark.uart), &bytes.data[i * sizeof(dark.uart)]));
+        }
+    });
+
+    test("sigma_delta_dither", []{
+        const unsigned N = 2;
+        uint16_t color[N][3] = {{0x0140, 0x0000, 0xfff0}, {0x00ff, 0x0080, 0x0101}};
+        encoder<N> e;
+        bitstream<N> bits;
+
+        unsigned sum[N][3] = {};
+
+        for (unsigned frame = 0; frame < 256; ++frame) {
+            e.encode(color, 0xff, format::bitbang, bits);
+
+            for (unsigned i = 0; i < N; ++i) {
+                for (unsigned j = 0; j < 3; ++j) {
+                    static const unsigned shift[3] = {8, 16, 0};
+                    uint32_t grb = 0;
+                    for (unsigned b = 0; b < 24; ++b)
+                        grb = grb << 1 | (bits.led(i)[b] == t1_hi);
+                    sum[i][j] += grb >> shift[j] & 0xff;
+                }
+            }
+        }
+
+        // 256 frames of value + fract * 0xff / 0x100
+        for (unsigned i = 0; i < N; ++i) {
+            for (unsigned j = 0; j < 3; ++j) {
+                unsigned value = color[i][j] >> 8;
+                unsigned fract = (color[i][j] & 0xff) * 0xff >> 8;
+                unsigned expected = value * 256 + (value < 0xff ? fract : 0);
+                assert(sum[i][j] == expected);
+            }
+        }
+    });
+
+    return 0;
+}
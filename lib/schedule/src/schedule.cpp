@@ -0,0 +1,52 @@
+#include <algorithm>
+#include <iterator>
+
+#include "schedule.hpp"
+
+const uint32_t *schedule::in_use(const uint32_t *alarms, unsigned& count) {
+    if (count == 0 || !std::all_of(alarms, alarms + count, [](uint32_t a) { return a == 0xffffffff; }))
+        return alarms;
+
+    count = std::size(default_alarms);
+    return default_alarms;
+}
+
+schedule::time_s schedule::next(const uint32_t *alarms, unsigned count, time_s from) {
+    time_s midnight = from - (from % 86400 + 86400) % 86400;
+    unsigned day = weekday(midnight);
+    time_s best = never;
+
+    // today and a full week after, for alarms earlier in the day than from
+    for (unsigned d = 0; d <= 7 && best == never; ++d, midnight += 86400, day = (day + 1) % 7) {
+        for (unsigned i = 0; i < count; ++i) {
+            if (!enabled(alarms[i]) || !(days(alarms[i]) & (1 << day)))
+                continue;
+
+            time_s t = midnight + minute_of_day(alarms[i]) * 60;
+            if (t >= from && t < best)
+                best = t;
+        }
+    }
+
+    return best;
+}
+
+void schedule::scheduler::update(const uint32_t *alarms, unsigned count, uint32_t duration, time_s now) {
+    m_alarms = alarms;
+    m_count = count;
+    m_duration = duration;
+
+    // an alarm that started less than duration ago is still due
+    m_next = next(alarms, count, now - duration + 1);
+}
+
+bool schedule::scheduler::advance(time_s now, uint32_t& elapsed) {
+    bool due = now - m_next < m_duration;
+    if (due)
+        elapsed = now - m_next;
+
+    time_s from = now - m_duration + 1;
+    m_next = next(m_alarms, m_count, m_next + 1 > from ? m_next + 1 : from);
+
+    return due;
+}
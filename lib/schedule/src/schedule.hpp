@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+
+namespace schedule {
+
+// local epoch seconds
+using time_s = int64_t;
+
+static constexpr time_s never = INT64_MAX;
+
+// alarm: weekday mask << 16 | minute of day, bit 0 of the mask is Sunday;
+// an empty mask or a minute past the end of the day (erased config) is unused
+static constexpr uint8_t every_day = 0x7f;
+static constexpr uint8_t weekdays = 0x3e;
+static constexpr uint8_t weekends = 0x41;
+
+constexpr uint32_t alarm(uint8_t hour, uint8_t minute, uint8_t days = every_day) {
+    return uint32_t(days) << 16 | (hour * 60 + minute);
+}
+
+constexpr unsigned minute_of_day(uint32_t alarm) { return alarm & 0xffff; }
+constexpr uint8_t days(uint32_t alarm) { return (alarm >> 16) & every_day; }
+constexpr bool enabled(uint32_t alarm) { return days(alarm) && minute_of_day(alarm) < 24 * 60; }
+
+// daily at 7:30 and 23:30, the alarms before they were configurable
+static constexpr uint32_t default_alarms[] = {alarm(7, 30), alarm(23, 30)};
+
+// alarms, or default_alarms if the table is erased (all 0xffffffff: a
+// config written before it had alarms); count is set to match
+const uint32_t *in_use(const uint32_t *alarms, unsigned& count);
+
+// 0: Sunday, the epoch was a Thursday
+constexpr unsigned weekday(time_s t) { return ((t >= 0 ? t / 86400 : (t - 86399) / 86400) % 7 + 11) % 7; }
+
+// first trigger of any of the alarms at or after from
+time_s next(const uint32_t *alarms, unsigned count, time_s from);
+
+// Caches the start of the next (or current) alarm window so polling is a
+// single comparison until it is reached. Call update() after the clock or
+// the alarms change.
+class scheduler {
+public:
+    void update(const uint32_t *alarms, unsigned count, uint32_t duration, time_s now);
+
+    // true when an alarm window contains now, elapsed is the time since it
+    // started; windows that already ended are skipped
+    inline bool poll(time_s now, uint32_t& elapsed) {
+        if (now < m_next)
+            return false;
+        return advance(now, elapsed);
+    }
+
+    inline time_s next_alarm() const { return m_next; }
+
+private:
+    bool advance(time_s now, uint32_t& elapsed);
+
+    const uint32_t *m_alarms = nullptr;
+    unsigned m_count = 0;
+    uint32_t m_duration = 0;
+    time_s m_next = never;
+};
+
+}
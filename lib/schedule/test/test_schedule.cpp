@@ -0,0 +1,148 @@
+#include <cassert>
+#include <vector>
+
+#include "test.h"
+
+#include "../src/schedule.hpp"
+#include "../src/schedule.cpp"
+
+using namespace schedule;
+
+// Sunday 2024-01-07 00:00
+static const time_s sunday = 1704585600;
+
+struct start { time_s at; uint32_t elapsed; };
+
+// a week of loop() passes, one per step, with the light running for
+// duration after each start
+static std::vector<start> simulate(std::vector<uint32_t> const& alarms, uint32_t duration,
+                                   time_s begin, time_s step = 1) {
+    scheduler s;
+    s.update(alarms.data(), alarms.size(), duration, begin);
+
+    std::vector<start> starts;
+    time_s running_until = begin;
+
+    for (time_s now = begin; now < begin + 7 * 86400; now += step) {
+        if (now < running_until)
+            continue;
+
+        uint32_t elapsed;
+        if (s.poll(now, elapsed)) {
+            starts.push_back({now, elapsed});
+            running_until = now - elapsed + duration;
+        }
+    }
+
+    return starts;
+}
+
+int main() {
+    test("weekday", []{
+        assert(weekday(0) == 4);
+        assert(weekday(sunday) == 0);
+        assert(weekday(sunday + 86399) == 0);
+        assert(weekday(sunday + 86400) == 1);
+        assert(weekday(-1) == 3);
+    });
+
+    test("week_of_defaults", []{
+        // from 2:00, after the previous night's alarm ended
+        auto starts = simulate({alarm(7, 30), alarm(23, 30)}, 90 * 60, sunday + 2 * 3600);
+        assert(starts.size() == 14);
+
+        for (unsigned i = 0; i < 14; ++i) {
+            time_s expected = sunday + (i / 2) * 86400 + (i % 2 ? 23 * 3600 + 30 * 60 : 7 * 3600 + 30 * 60);
+            assert(starts[i].at == expected);
+            assert(starts[i].elapsed == 0);
+        }
+    });
+
+    test("weekday_mask", []{
+        auto starts = simulate({alarm(6, 0, weekdays), alarm(9, 0, weekends)}, 600, sunday, 60);
+        assert(starts.size() == 7);
+
+        for (auto& s : starts) {
+            unsigned d = weekday(s.at);
+            time_s minute = (s.at - sunday) % 86400 / 60;
+            assert(minute == (d == 0 || d == 6 ? 9 * 60 : 6 * 60));
+        }
+    });
+
+    test("start_inside_window", []{
+        // boots (or syncs NTP) 15 min into the 7:30 alarm
+        auto starts = simulate({alarm(7, 30)}, 90 * 60, sunday + 7 * 3600 + 45 * 60);
+        assert(starts.size() == 8);
+        assert(starts[0].elapsed == 15 * 60);
+        assert(starts[1].elapsed == 0);
+    });
+
+    test("coarse_polling", []{
+        // loop() stalled: still starts, late, with the elapsed time
+        auto starts = simulate({alarm(7, 30)}, 90 * 60, sunday, 7 * 60);
+        assert(starts.size() == 7);
+        for (auto& s : starts)
+            assert(s.at - s.elapsed == sunday + (s.at - sunday) / 86400 * 86400 + 7 * 3600 + 30 * 60);
+    });
+
+    test("clock_jump_skips_ended_window", []{
+        uint32_t alarms[] = {alarm(7, 30)};
+        scheduler s;
+        s.update(alarms, 1, 600, sunday);
+        assert(s.next_alarm() == sunday + 7 * 3600 + 30 * 60);
+
+        uint32_t elapsed;
+        assert(!s.poll(sunday + 12 * 3600, elapsed));
+        assert(s.next_alarm() == sunday + 86400 + 7 * 3600 + 30 * 60);
+    });
+
+    test("overlapping_alarms", []{
+        // the second one starts while the first is running and is picked up
+        // when the first ends
+        auto starts = simulate({alarm(7, 0, 1), alarm(7, 10, 1)}, 30 * 60, sunday);
+        assert(starts.size() == 2);
+        assert(starts[1].at == sunday + 7 * 3600 + 30 * 60);
+        assert(starts[1].elapsed == 20 * 60);
+    });
+
+    test("wraps_to_next_week", []{
+        uint32_t alarms[] = {alarm(8, 0, 1)};  // Sundays
+        assert(next(alarms, 1, sunday + 9 * 3600) == sunday + 7 * 86400 + 8 * 3600);
+    });
+
+    test("unused_entries", []{
+        uint32_t alarms[] = {0, 0xffffffff, alarm(24, 0), alarm(5, 0, 0)};
+        assert(next(alarms, 4, sunday) == never);
+
+        scheduler s;
+        s.update(alarms, 4, 600, sunday);
+
+        uint32_t elapsed;
+        assert(!s.poll(sunday + 7 * 86400, elapsed));
+    });
+
+    test("erased_table", []{
+        // upgraded from a config without alarms
+        std::vector<uint32_t> erased(8, 0xffffffff);
+        unsigned count = erased.size();
+        auto *alarms = in_use(erased.data(), count);
+        assert(alarms == default_alarms && count == 2);
+
+        std::vector<uint32_t> defaults(alarms, alarms + count);
+        auto starts = simulate(defaults, 90 * 60, sunday + 2 * 3600);
+        assert(starts.size() == 14);
+        assert(starts[0].at == sunday + 7 * 3600 + 30 * 60);
+
+        // one entry set: the table is in use, the other unused
+        erased[3] = alarm(6, 0);
+        count = erased.size();
+        assert(in_use(erased.data(), count) == erased.data() && count == 8);
+
+        // all disabled on purpose is not erased
+        std::vector<uint32_t> off(8, 0);
+        count = off.size();
+        assert(in_use(off.data(), count) == off.data());
+    });
+
+    return 0;
+}
@@ -1,4 +1,4 @@
-#include <vector>
+#include <charconv>
 
 #include <ArduinoOTA.h>
 #include <EEPROM.h>
@@ -9,7 +9,20 @@
 #include <button_fcn.h>
 #include <espbase.h>
 
-#include <NTPClient.h>
+#include <clock.hpp>
+#include <dns.hpp>
+#include <effects.hpp>
+#include <frame_buffer.hpp>
+#include <ntp.hpp>
+#include <pacer.hpp>
+#include <profile.hpp>
+#include <rate_control.hpp>
+#include <refresh.hpp>
+#include <render.hpp>
+#include <schedule.hpp>
+#include <scheduler.hpp>
+#include <trace.hpp>
+#include <ws2812.hpp>
 
 #define SECS_PER_MIN  (60UL)
 #define SECS_PER_HOUR (3600UL)
@@ -20,21 +33,52 @@
 
 
 uint32_t timer_int_handle_time = 0;
+uint32_t timer_interval = 0;
 uint32_t loop_interval = 0;
 
-const int NUM_LEDS = 60;
-static uint16_t led_color[NUM_LEDS][3];  // RGB
+int32_t frame_lateness = 0;  // last frame sent vs. its target, cycles
 
+uint32_t window_overruns = 0;
+uint32_t window_max_gap = 0;
 
-static double t = 0;
+const int NUM_LEDS = 60;
+static uint16_t led_color[NUM_LEDS][3];  // RGB, 8.8
+static ledstrip::phase_lut phase_lut;
+static ledstrip::gamma_lut day_lut;
+static ledstrip::gamma_lut night_lut;
+static ledstrip::color_ramp color_ramp;
+static const uint8_t night_brightness = 10;
+static ledstrip::ws2812::encoder<NUM_LEDS> encoder;
+static ledstrip::frame_buffer<ledstrip::ws2812::bitstream<NUM_LEDS>> frames;
+static const ledstrip::ws2812::dark_led dark_led;  // the blank frame, repeated
+
+
+static espbase::cycle_clock cycles;  // extended ccount, updated in loop()
+static uint64_t start_cycles;  // when the animation started
 static bool is_running;
 
-static const unsigned reset_time = 500000 * 80 / 1000;
-static const unsigned t0_hi = 400 * 80 / 1000;
-static const unsigned t0_lo = 850 * 80 / 1000;
+const unsigned max_alarms = 8;
+static schedule::scheduler alarm_schedule;
+
+static ledstrip::refresh_policy refresh(F_CPU);  // keep-alive every second
+static ledstrip::frame_pacer pacer(F_CPU / 400);
+static ledstrip::rate_controller rate;
 
-static const unsigned t1_hi = 800 * 80 / 1000;
-static const unsigned t1_lo = 450 * 80 / 1000;
+static espbase::profile_section perf_calc_colors("calc_colors");
+static espbase::profile_section perf_update_strip("update_strip");
+static espbase::profile_section perf_eeprom_commit("EEPROM.commit");
+static uint32_t last_timer_int;  // 0: do not check the next period
+static bool strip_blank;
+static bool strip_stale = true;
+
+// The light is off and the strip shows the blank frame: the output has
+// stopped and loop() sleeps between passes until it is turned on again.
+static volatile bool output_idle;
+static const unsigned idle_sleep_ms = 10;
+static uint64_t idle_cycles;  // spent sleeping
+
+using ledstrip::ws2812::reset_time;
+using ledstrip::ws2812::bit_period;
 
 
 #define d3_hi() (GPOS = 1 << D3)
@@ -44,7 +88,26 @@ static const unsigned t1_lo = 450 * 80 / 1000;
 
 
 WiFiUDP ntpUDP;
-NTPClient timeClient(ntpUDP, "pool.ntp.org", 3600);
+espbase::ntp_client<WiFiUDP> ntp(ntpUDP, 3600);
+// looked up again for every sync, pool.ntp.org's TTL is shorter than that
+espbase::dns_lookup ntp_server("pool.ntp.org", ntp.interval());
+
+
+enum trace_events : uint8_t {
+    trace_isr_enter = espbase::trace_user,
+    trace_isr_exit,
+    trace_frame_publish,    // arg: frames published
+    trace_ntp_sync,         // arg: rtt in ms
+    trace_alarm,            // arg: seconds since it started
+    trace_idle,
+    trace_wake,
+};
+
+
+enum output_backend : uint8_t {
+    backend_bitbang,    // D3 from the timer1 ISR, also for unknown values
+    backend_uart,       // D4 (GPIO2) from UART1 TX, written in loop()
+};
 
 
 static espbase::config_base::meta config_meta;
@@ -59,6 +122,13 @@ struct Config : espbase::config {
     member<uint16_t>    variation       = {&config_meta, "variation",       0x0100};
     member<uint8_t>     max_progression_night   = {&config_meta, "max_progression_night",   0x40};  // 0x40 / 0xff ~= 0.25
     member<uint16_t>    led_update_freq = {&config_meta, "led_update_freq", 400};
+    member<uint8_t>     led_backend     = {&config_meta, "led_backend",     backend_bitbang};
+    member<uint8_t>     led_irq_window  = {&config_meta, "led_irq_window",  0};  // max gap between LEDs in us, min_irq_window_us to ws2812::latch_us, 0x00/0xff: off
+    member<uint8_t>     led_gamma       = {&config_meta, "led_gamma",       22};  // 1/10, 0x00/0xff: linear
+    member<uint8_t>     effect          = {&config_meta, "effect",          0};  // index into ledstrip::effects
+    member<uint16_t[ledstrip::color_ramp::max_keyframes * 4]> ramp = {&config_meta, "ramp", ledstrip::color_ramp::default_keyframes};  // (time, r, g, b) keyframes
+    member<uint32_t[max_alarms]> alarms = {&config_meta, "alarms", schedule::default_alarms};  // weekday mask << 16 | minute of day, erased: defaults
+    member<uint8_t>     led_irq_share   = {&config_meta, "led_irq_share",   80};  // max % of CPU for the output ISR, 0x00/0xff: 80
 };
 
 
@@ -69,41 +139,39 @@ static Config& config = *[]{
 
 
 __always_inline static uint32_t __clock_cycles() {
-    uint32_t cycles;
-    __asm__ __volatile__ ("rsr %0,ccount":"=a" (cycles));
-    return cycles;
+    return ESP.getCycleCount();
 }
 
 
-std::vector<char> buffer;
 void read_serial() {
-    while (int length = Serial.available()) {
-        buffer.resize(length);
-        length = Serial.read(buffer.data(), buffer.size());
-        Serial.write(buffer.data(), buffer.size());
-
-        if (length > 0) {
-            espbase::dbg = &Serial;
-            espbase::parse_command(std::move(buffer));
-        }
+    static char buffer[64];  // the RX FIFO is 128 B, longer lines take more reads
+
+    while (int available = Serial.available()) {
+        int length = Serial.read(buffer, min<size_t>(available, sizeof(buffer)));
+        if (length <= 0)
+            break;
+
+        Serial.write(buffer, length);
+
+        espbase::dbg = &Serial;
+        espbase::parse_command(buffer, length);
     }
 }
 
 
-IRAM_ATTR static inline void write_led(uint32_t c) {
+IRAM_ATTR static inline void write_led(const uint8_t *high) {
     uint32_t clk;
 
     for (unsigned i = 0; i < 24; ++i) {
         d3_hi();
         clk = __clock_cycles();
-        clk += (c & 0x800000) ? t1_hi : t0_hi;
+        clk += high[i];
         clk -= 12;
         while (__clock_cycles() < clk);
 
         d3_lo();
-        clk += (c & 0x800000) ? t1_lo : t0_lo;
+        clk += bit_period - high[i];
         clk -= 12;
-        c <<= 1;
         while (__clock_cycles() < clk);
     }
 }
@@ -117,82 +185,189 @@ void reset_strip_protocol() {
 }
 
 
-void calc_colors() {
-    auto hour = timeClient.getHours();
-    auto max_brightness = (hour >= 4 && hour <= 16) ? config.led_brightness.value : 10;
-    float max_progression = (hour >= 4 && hour <= 16) ? 1.0f : float(config.max_progression_night) / 0xff;
+// at: when the frame is shown, on the extended clock
+void calc_colors(uint64_t at) {
+    espbase::profile_scope perf(perf_calc_colors);
+
+    auto hour = ntp.hours(millis());
+    bool day = hour >= 4 && hour <= 16;
+
+    ledstrip::render_input in = {
+        .t_ms = espbase::cycles_to_ms(at - start_cycles, F_CPU),
+        .max_progression = uint16_t(day ? 0xffff : config.max_progression_night * 0x0101),
+        .animation_speed = config.animation_speed,
+        .duration = config.duration,
+        .variation = config.variation,
+        .led_count = config.led_count,
+    };
+
+    ledstrip::render(config.effect, ledstrip::prepare(in, color_ramp), phase_lut, day ? day_lut : night_lut, led_color);
+}
 
-    float st = t * config.animation_speed.value / 0x0100;
-    float _, t10 = min(modff(t / config.duration, &_) * 2.0f, max_progression);
 
-    for (unsigned i = 0; i < config.led_count; ++i) {
-        float x = float(i) / config.led_count.value * config.variation / 0x0100;
+void update_schedule() {
+    unsigned count = max_alarms;
+    auto *alarms = schedule::in_use(config.alarms.value, count);
+    alarm_schedule.update(alarms, count, config.duration, ntp.epoch(millis()));
+}
 
-        float color = 0;
 
-        // float f1 = sqrtf(sinf(2 * PI * (x * 2 - st * 0.5)) * 0.5 + 0.5);
-        // f1 = 1;
-        float f2 = sqrtf(sinf(2 * PI * (x * 5 - st * 0.04)) * 0.5 + 0.5);
-        float f3 = sqrtf(sinf(2 * PI * (x * 11 + st * 0.1)) * 0.5 + 0.5);
+void update_gamma() {
+    float gamma = (config.led_gamma == 0x00 || config.led_gamma == 0xff) ? 1.0f : config.led_gamma / 10.0f;
+
+    day_lut.build(config.led_brightness, gamma);
+    night_lut.build(night_brightness, gamma);
+}
 
-        // color = min(min(f1, f2), f3);
-        color = min(f2, f3);
-        // color = i / 59.0;
 
-        if (color < 0)
-            color = 0;
-        else if (color > 1)
-            color = 1;
+void encode_strip(uint32_t target) {
+    auto format = (config.led_backend == backend_uart) ? ledstrip::ws2812::format::uart
+                                                       : ledstrip::ws2812::format::bitbang;
 
-        float r = max_brightness * color * min(2.5f * t10, 1.0f);
-        float g = max_brightness * color * t10;
-        float b = max_brightness * color * min(t10 < 0.5f ? 0.5f * t10 : 1.5f * t10 - 0.5f, 1.0f);
+    frames.back().target = target;
 
-        led_color[i][0] = r * 0x100;
-        led_color[i][1] = g * 0x100;
-        led_color[i][2] = b * 0x100;
+    // an unchanged frame is not published, the output then only sends keep-alives
+    if (encoder.encode(led_color, config.led_dither_max, format, frames.back())) {
+        frames.publish();
+        espbase::tracer.record(trace_frame_publish, frames.published());
     }
+}
 
-    for (unsigned i = config.led_count; i < NUM_LEDS; ++i) {
-        for (unsigned j = 0; j < 3; ++j) {
-            led_color[i][j] = 0x0000;
-        }
+
+// Whether to send at this output tick, false if the strip already shows
+// the frame. Sending is skipped while the frame is static, dithering keeps
+// publishing new frames and with that the full refresh rate. frame is set
+// to nullptr for the blank frame, see dark_led.
+IRAM_ATTR static bool next_frame(uint32_t clk, const ledstrip::ws2812::bitstream<NUM_LEDS> *&frame) {
+    bool fresh = strip_stale || (is_running ? frames.pending() || strip_blank : !strip_blank);
+
+    if (!refresh.due(clk, fresh))
+        return false;
+
+    strip_stale = false;
+    strip_blank = !is_running;
+
+    if (!is_running) {
+        frame = nullptr;
+        return true;
     }
+
+    frame = &frames.acquire();
+    frame_lateness = clk - frame->target;
+    return true;
 }
 
 
-void clear_strip() {
-    for (unsigned i = 0; i < NUM_LEDS; ++i)
-        write_led(0x000000);
+IRAM_ATTR static inline const uint8_t *led_bits(const ledstrip::ws2812::bitstream<NUM_LEDS> *frame, unsigned i) {
+    return frame ? frame->led(i) : dark_led.bitbang;
 }
 
 
-void update_strip() {
-    static uint32_t leds[NUM_LEDS] = {0};
-    static int8_t dither[NUM_LEDS][3] = {0};
+void update_strip(const ledstrip::ws2812::bitstream<NUM_LEDS> *frame) {
+    espbase::profile_scope perf(perf_update_strip);
 
-    for (unsigned i = 0; i < NUM_LEDS; ++i) {
-        static uint8_t rgb[3];
+    for (unsigned i = 0; i < NUM_LEDS; ++i)
+        write_led(led_bits(frame, i));
+}
 
-        for (unsigned j = 0; j < 3; ++j) {
-            rgb[j] = led_color[i][j] >> 8;
-            uint8_t fract = uint16_t(led_color[i][j] & 0xff) * config.led_dither_max >> 8;
 
-            if (dither[i][j] <= 0) {
-                dither[i][j] += fract;
-            } else {
-                dither[i][j] -= config.led_dither_max - fract;
+void uart_strip() {
+    static uint32_t clk_prev;
 
-                if (rgb[j] < 0xff && fract > 0)
-                    rgb[j] += 1;
-            }
+    // the previous frame has to be out and latched before the next starts
+    static const uint32_t min_interval = ledstrip::ws2812::uart_cycles(NUM_LEDS * sizeof(dark_led.uart)) +
+                                         ledstrip::ws2812::reset_time;
+
+    auto clk = __clock_cycles();
+    if (clk - clk_prev < max<uint32_t>(F_CPU / max<uint32_t>(config.led_update_freq, 1), min_interval))
+        return;
+    clk_prev = clk;
+
+    // blocks until the last bytes are in the TX FIFO, interrupts stay enabled
+    const ledstrip::ws2812::bitstream<NUM_LEDS> *frame;
+    if (next_frame(clk, frame)) {
+        if (frame) {
+            Serial1.write(frame->data, frame->size);
+        } else {
+            for (unsigned i = 0; i < NUM_LEDS; ++i)
+                Serial1.write(dark_led.uart, sizeof(dark_led.uart));
+
+            output_idle = true;
+            espbase::tracer.record(trace_idle);
         }
+    }
+}
+
+
+// Windowed output re-arms timer1 this long after each LED. With the ISR's
+// entry and exit on top, the gap between LEDs cannot be shorter than
+// min_irq_window_us: a smaller led_irq_window would overrun every frame.
+static const uint32_t rearm = ledstrip::ws2812::ns_to_cycles(2000);
+static const unsigned min_irq_window_us = 5;
+
+
+// Sends one LED per interrupt and re-arms timer1 shortly after, so pending
+// interrupts get to run between LEDs. If the gap reaches led_irq_window,
+// kept between min_irq_window_us and the strip's latch time, the strip may
+// have latched a partial frame: the rest is dropped and the frame restarts
+// with the next period. Only the time in the ISR counts as its handle
+// time, not the gaps between LEDs.
+IRAM_ATTR static void stream_windowed() {
+    static const ledstrip::ws2812::bitstream<NUM_LEDS> *frame;
+    static unsigned led;
+    static uint32_t frame_start;
+    static uint32_t frame_busy;
+    static uint32_t last_bit;
 
-        leds[i] = rgb[0] << 8 | rgb[1] << 16 | rgb[2];
+    auto clk = __clock_cycles();
+
+    if (led == 0) {
+        if (!next_frame(clk, frame)) {
+            timer1_write(timer_interval);
+            return;
+        }
+        frame_start = clk;
+        frame_busy = 0;
+    } else {
+        uint32_t gap = clk - last_bit;
+        window_max_gap = max(window_max_gap, gap);
+
+        uint32_t window = max<uint32_t>(min<uint32_t>(config.led_irq_window, ledstrip::ws2812::latch_us),
+                                        min_irq_window_us);
+        if (gap >= window * (F_CPU / 1000000)) {
+            window_overruns = window_overruns + 1;
+            rate.overrun();
+            strip_stale = true;
+            led = 0;
+            timer1_write(timer_interval);
+            return;
+        }
     }
 
-    for (unsigned i = 0; i < NUM_LEDS; ++i) {
-        write_led(leds[i]);
+    ETS_INTR_LOCK();
+    write_led(led_bits(frame, led));
+    ETS_INTR_UNLOCK();
+
+    last_bit = __clock_cycles();
+    frame_busy += last_bit - clk;
+
+    if (++led < NUM_LEDS) {
+        timer1_write(rearm);
+    } else {
+        led = 0;
+        timer_int_handle_time = frame_busy;
+        rate.sample(timer_int_handle_time, false);
+
+        if (!frame) {
+            output_idle = true;
+            espbase::tracer.record(trace_idle);
+            timer1_disable();
+            return;
+        }
+
+        // the next frame starts a period after this one did
+        uint32_t took = last_bit - frame_start;
+        timer1_write(timer_interval > took + rearm ? timer_interval - took : rearm);
     }
 }
 
@@ -200,62 +375,120 @@ void update_strip() {
 IRAM_ATTR void timer_int_handler(void *, void *) {
     T1I = 0;  // clear interrupt flag
 
+    espbase::trace_scope trace(espbase::tracer, trace_isr_enter, trace_isr_exit);
+
     // led.toggle();
 
-    {
-        ETS_INTR_LOCK();
+    if (config.led_irq_window != 0x00 && config.led_irq_window != 0xff)
+        return stream_windowed();
 
-        if (is_running) {
-            update_strip();
-        } else {
-            clear_strip();
-        }
+    // timer1 reloads by itself, a longer period means the interrupt was held off
+    auto clk = __clock_cycles();
+    bool late = last_timer_int && clk - last_timer_int > timer_interval + timer_interval / 2;
+    last_timer_int = clk;
+
+    const ledstrip::ws2812::bitstream<NUM_LEDS> *frame;
+    if (!next_frame(clk, frame)) {
+        if (late)
+            rate.overrun();
+        return;
+    }
 
+    {
+        ETS_INTR_LOCK();
+        update_strip(frame);
         ETS_INTR_UNLOCK();
     }
 
     timer_int_handle_time = T1L - T1V;
+    rate.sample(timer_int_handle_time, late);
+
+    if (!frame) {
+        output_idle = true;
+        espbase::tracer.record(trace_idle);
+        timer1_disable();
+    }
 }
 
 
-void update_timer_interval() {
-    uint32_t interval = F_CPU / max<uint32_t>(config.led_update_freq, 1);
+// Moves the timer interval toward led_update_freq within the ISR's CPU
+// share, see rate_controller. Runs periodically from loop().
+void retune_timer() {
+    static const int bits = 23;
+    static const uint32_t max_interval = (1 << (bits - 1)) - 1;
 
-    {
-        static const int bits = 23;
-        uint32_t max_interval = (1 << (bits - 1)) - 1;
+    uint8_t share = config.led_irq_share;
+    if (share == 0x00 || share > 100)
+        share = 80;
+
+    uint32_t interval = rate.update(F_CPU / max<uint32_t>(config.led_update_freq, 1), share, max_interval);
+    if (interval == timer_interval)
+        return;
 
-        interval = min(interval, max_interval);
+    timer_interval = interval;
+    pacer.set_interval(interval);
+
+    // the windowed ISR picks it up at the end of the frame
+    if (config.led_irq_window == 0x00 || config.led_irq_window == 0xff) {
+        last_timer_int = 0;
+        timer1_write(interval);
     }
+}
 
-    {
-        uint32_t min_interval;
 
-        if (timer_int_handle_time) {
-            min_interval = timer_int_handle_time;
-        } else {
-            auto clk = __clock_cycles();
-            timer_int_handler(nullptr, nullptr);
-            min_interval = __clock_cycles() - clk;
-        }
+void update_timer_interval() {
+    rate.reset();
 
-        min_interval = min_interval * 1.2;
+    // start from a known ISR cost so a too high rate cannot starve loop(),
+    // before the first frame that of bit-banging all of it
+    static const uint32_t frame_time =
+        NUM_LEDS * ledstrip::ws2812::bitstream<NUM_LEDS>::bits_per_led * ledstrip::ws2812::bit_period;
+    rate.sample(timer_int_handle_time ? timer_int_handle_time : frame_time, false);
+
+    retune_timer();
+}
+
+
+void enable_timer() {
+    if (config.led_backend != backend_uart && !output_idle)
+        timer1_enable(TIM_DIV1, TIM_EDGE, TIM_LOOP);
+}
 
-        interval = max(interval, min_interval);
-    }
 
-    config.led_update_freq = round(double(F_CPU) / interval);
-    timer1_write(interval);
+// Restarts the output after idle, the first frame goes out right away.
+void wake_output() {
+    espbase::tracer.record(trace_wake);
+    output_idle = false;
+    strip_stale = true;
+    last_timer_int = 0;
+    enable_timer();
 }
 
 
-#define enable_timer()  timer1_enable(TIM_DIV1, TIM_EDGE, TIM_LOOP)
+void setup_output() {
+    // the new output has not blanked the strip yet
+    output_idle = false;
+    strip_stale = true;
+
+    if (config.led_backend == backend_uart) {
+        timer1_disable();
+        Serial1.begin(ledstrip::ws2812::uart_baud, SERIAL_6N1, SERIAL_TX_ONLY, 2, true);
+    } else {
+        Serial1.end();
+        pinMode(LED_BUILTIN, OUTPUT);
+        digitalWrite(LED_BUILTIN, !config.builtin_led);
+        enable_timer();
+    }
+}
+
 
 void setup_timer() {
     ETS_FRC_TIMER1_INTR_ATTACH(timer_int_handler, NULL);
     ETS_FRC1_INTR_ENABLE();
 
     config_meta.on_change("led_update_freq", update_timer_interval);
+    config_meta.on_change("led_irq_share", update_timer_interval);
+    config_meta.on_change("led_backend", setup_output);
 
     enable_timer();
 
@@ -265,50 +498,95 @@ void setup_timer() {
 }
 
 
-void setup() {
-    Serial.begin(8 * 115200);
-    espbase::dbg = &Serial;
+// loop() work, in priority order, see setup_tasks()
+static espbase::scheduler tasks([]{ return __clock_cycles(); });
 
-    espbase::setup();
 
-    if (config.led_count > NUM_LEDS)
-        config.led_count = NUM_LEDS;
+void check_alarms() {
+    // alarms are in local time, unknown until the first NTP reply
+    if (is_running || !ntp.synced())
+        return;
 
-    espbase::on_wifi_connected = []{
-        // snprintf(device_name, sizeof(device_name), "wul-%s", espbase::device_id());
-        // MDNS.begin(device_name);
-        // MDNS.addService("wul-config", "tcp", 1444);
-    };
+    uint32_t elapsed;
+    if (alarm_schedule.poll(ntp.epoch(millis()), elapsed)) {
+        start_cycles = cycles.now() - espbase::seconds_to_cycles(elapsed, F_CPU);
+        is_running = true;
+        espbase::tracer.record(trace_alarm, min<uint32_t>(elapsed, 0xffff));
+    }
+}
 
-    timeClient.begin();
-    timeClient.setUpdateInterval(1024 * 1000);
 
-    pinMode(LED_BUILTIN, OUTPUT);
-    config_meta.on_change("builtin_led", []{ digitalWrite(LED_BUILTIN, !config.builtin_led); });
+void render_frame() {
+    // render only what the output will take, for when it will show it
+    uint32_t clk = __clock_cycles();
+    uint64_t now = cycles.update(clk);
 
-    pinMode(D3, OUTPUT);
-    d3_lo();
+    if (!is_running) {
+        pacer.stop();
+    } else if (pacer.due(clk, frames.pending())) {
+        calc_colors(now + int32_t(pacer.target() - clk));
+        encode_strip(pacer.target());
+    }
+}
 
-    espbase::command("off", []{ is_running = false; });
-    espbase::command("on", []{
-        is_running = true;
-        t = 0;
-    });
-    espbase::command("d3_lo", []{ d3_lo(); });
-    espbase::command("d3_hi", []{ d3_hi(); });
 
-    espbase::command("time", []{
-        espbase::print("time: %s\n", timeClient.getFormattedTime().c_str());
+void setup_tasks() {
+    const uint32_t ms = F_CPU / 1000;
+
+    tasks.add("render",     0,          2 * ms, render_frame);
+    tasks.add("uart",       0,          4 * ms, []{
+        if (config.led_backend == backend_uart && !output_idle)
+            uart_strip();
+    });
+    tasks.add("alarms",     100 * ms,   1 * ms, check_alarms);
+    tasks.add("retune",     250 * ms,   1 * ms, []{
+        if (!output_idle)
+            retune_timer();
     });
+    tasks.add("serial",     0,          5 * ms, read_serial);
+    tasks.add("espbase",    0,          5 * ms, espbase::loop);
+    tasks.add("ntp",        10 * ms,    1 * ms, []{
+        // MDNS.update();
+        if (ntp_server.update(millis()))
+            ntp.set_server(ntp_server.address(), millis());
+
+        if (ntp.update(millis())) {
+            espbase::tracer.record(trace_ntp_sync, min<uint32_t>(ntp.statistics().last_rtt_ms, 0xffff));
+            update_schedule();
+        }
+    });
+}
 
-    espbase::command("d", []{
+
+static constexpr auto commands = espbase::sorted_commands({
+    {"off", [](auto&){ is_running = false; }},
+    {"on", [](auto&){
+        is_running = true;
+        start_cycles = cycles.now();
+    }},
+    {"d3_lo", [](auto&){ d3_lo(); }},
+    {"d3_hi", [](auto&){ d3_hi(); }},
+
+    {"time", [](auto&){
+        auto now = millis();
+        auto& s = ntp.statistics();
+
+        espbase::print("time: %s%s\n", ntp.formatted_time(now).c_str(), ntp.synced() ? "" : " (not synced)");
+        espbase::print("ntp server: %s %s\n", ntp_server.host(), IPAddress(ntp.server()).toString().c_str());
+        espbase::print("ntp sent: %u, received: %u, rejected: %u, timeouts: %u\n",
+                       s.sent, s.received, s.rejected, s.timeouts);
+        espbase::print("last offset: %d ms, rtt: %u ms, slewing: %d ms\n",
+                       s.last_offset_ms, s.last_rtt_ms, ntp.slew_remaining(now));
+    }},
+
+    {"d", [](auto&){
         uint32_t free; uint16_t max; uint8_t frag;
         ESP.getHeapStats(&free, &max, &frag);
 
         espbase::print("\nRAM:\n"
                         "    free:          %.3lf kB\n"
                         "    largest block: %.3lf kB\n"
-                        "    fragmentation: %u %\n\n",
+                        "    fragmentation: %u %%\n\n",
                         free / 1000.0, max / 1000.0, frag);
 
         espbase::print("Reset info:\n    %s\n\n", ESP.getResetInfo().c_str());
@@ -317,82 +595,233 @@ void setup() {
                        timer_int_handle_time, double(F_CPU) / timer_int_handle_time);
         espbase::print("loop_interval: %u cycles (%.2lf Hz)\n",
                        loop_interval, double(F_CPU) / loop_interval);
-        espbase::print("led_update_freq: %u Hz\n\n", config.led_update_freq.value);
+        espbase::print("led_update_freq: %u Hz\n", config.led_update_freq.value);
+        espbase::print("window overruns: %u\n", window_overruns);
+        espbase::print("window max gap: %u cycles\n\n", window_max_gap);
 
-        espbase::print("time: %s\n", timeClient.getFormattedTime().c_str());
+        espbase::print("time: %s\n", ntp.formatted_time(millis()).c_str());
         espbase::print("T1L: %u (%.2lf Hz)\n", T1L, double(F_CPU) / T1L);
         espbase::print("T1V: %u\n\n", T1V);
 
-        espbase::print("t: %lf\n", t);
+        espbase::print("t: %.3lf\n", espbase::cycles_to_ms(cycles.now() - start_cycles, F_CPU) / 1000.0);
         espbase::print("is_running: %u\n", is_running);
-    });
+        espbase::print("output idle: %u\n", output_idle);
+        espbase::print("frames published: %u\n", frames.published());
+        espbase::print("frames consumed: %u\n", frames.consumed());
+        espbase::print("frames sent: %u\n", refresh.sent());
+        espbase::print("frames skipped: %u\n", refresh.skipped());
+        espbase::print("dithering: %u\n", encoder.dithering());
+
+        {
+            static uint32_t prev_ms, prev_rendered, prev_consumed;
+            static uint64_t prev_cycles, prev_idle;
+            auto ms = millis();
+            auto now = cycles.update(__clock_cycles());
+            double dt = (ms - prev_ms) / 1000.0;
+
+            espbase::print("idle time: %.1lf %% (%.1lf %% since boot)\n",
+                           100.0 * (idle_cycles - prev_idle) / (now - prev_cycles),
+                           100.0 * idle_cycles / now);
+
+            espbase::print("render rate: %.1lf Hz\n", (pacer.rendered() - prev_rendered) / dt);
+            espbase::print("consume rate: %.1lf Hz\n", (frames.consumed() - prev_consumed) / dt);
+            espbase::print("frames dropped: %u\n", pacer.dropped());
+            espbase::print("frame lateness: %d cycles\n", frame_lateness);
+
+            prev_ms = ms;
+            prev_rendered = pacer.rendered();
+            prev_consumed = frames.consumed();
+            prev_cycles = now;
+            prev_idle = idle_cycles;
+        }
+    }},
 
-    espbase::command("t0", [](std::vector<std::vector<char>>&& args){
-        if (args.size() == 1) {
-            args[0].push_back('\n');
-            t = atoi(args[0].data());
-        } else {
-            t = 0;
+    {"effects", [](auto&){
+        unsigned current = config.effect < ledstrip::effect_count ? config.effect : 0;
+
+        for (unsigned i = 0; i < ledstrip::effect_count; ++i)
+            espbase::print("%c %u: %s\n", i == current ? '*' : ' ', i, ledstrip::effect_name(i));
+    }},
+
+    {"ramp", [](auto&){
+        // keyframes actually in use, an invalid ramp shows the default
+        ledstrip::color_ramp ramp;
+        ramp.build(config.ramp);
+        auto *k = config.ramp.value[0] == 0 ? config.ramp.value : ledstrip::color_ramp::default_keyframes;
+
+        for (unsigned i = 0; i < ramp.size(); ++i, k += 4)
+            espbase::print("%5.3f: %5.3f %5.3f %5.3f\n",
+                           k[0] / 65535.0, k[1] / 65535.0, k[2] / 65535.0, k[3] / 65535.0);
+    }},
+
+    {"alarms", [](auto&){
+        static const char day_names[] = "SMTWTFS";
+
+        unsigned count = max_alarms;
+        auto *alarms = schedule::in_use(config.alarms.value, count);
+        if (alarms != config.alarms.value)
+            espbase::print("erased, the defaults:\n");
+
+        for (unsigned i = 0; i < count; ++i) {
+            uint32_t alarm = alarms[i];
+            if (!schedule::enabled(alarm))
+                continue;
+
+            char days[8] = {};
+            for (unsigned d = 0; d < 7; ++d)
+                days[d] = schedule::days(alarm) & (1 << d) ? day_names[d] : '-';
+
+            espbase::print("%u: %02u:%02u %s\n", i,
+                           schedule::minute_of_day(alarm) / 60, schedule::minute_of_day(alarm) % 60, days);
         }
-    });
 
-    espbase::command("disable-timer", [](std::vector<std::vector<char>>&& args){
+        long next = alarm_schedule.next_alarm() - ntp.epoch(millis());
+        if (alarm_schedule.next_alarm() == schedule::never)
+            espbase::print("no alarms\n");
+        else if (next >= 0)
+            espbase::print("next in %ld s\n", next);
+        else
+            espbase::print("started %ld s ago\n", -next);
+    }},
+
+    {"timer", [](auto&){
+        auto& h = rate.handle_time();
+
+        espbase::print("requested: %u Hz\n", config.led_update_freq.value);
+        espbase::print("current:   %.2lf Hz (%s)\n", double(F_CPU) / timer_interval,
+                       ledstrip::rate_controller::reason_name(rate.why()));
+        espbase::print("overruns:  %u\n", rate.overrun_count());
+        espbase::print("isr time:  p50 %u, p99 %u, max %u cycles\n",
+                       h.percentile(50), h.percentile(99), h.max());
+
+        for (unsigned i = 0; i < h.size(); ++i)
+            if (h.count(i))
+                espbase::print("    <= %8u: %u\n", h.upper(i), h.count(i));
+    }},
+
+    {"tasks", [](auto&){
+        espbase::print("%-10s %8s %8s %8s %8s %6s %6s  (cycles)\n",
+                       "task", "runs", "min", "avg", "max", "over", "defer");
+
+        for (auto& t : tasks.tasks()) {
+            auto& s = t.stats;
+            espbase::print("%-10s %8u %8u %8u %8u %6u %6u\n", t.name, s.runs,
+                           s.runs ? s.min : 0, s.avg(), s.max, s.overruns, s.deferred);
+        }
+    }},
+
+    {"tasks-reset", [](auto&){ tasks.reset_stats(); }},
+
+    {"t0", [](espbase::command_args const& args){
+        uint32_t t = 0;
+
+        if (args.size() == 1)
+            std::from_chars(args[0].data(), args[0].data() + args[0].size(), t);
+
+        start_cycles = cycles.now() - espbase::seconds_to_cycles(t, F_CPU);
+    }},
+
+    {"disable-timer", [](auto&){
         timer1_disable();
-    });
+    }},
 
-    espbase::command("enable-timer", [](std::vector<std::vector<char>>&& args){
+    {"enable-timer", [](auto&){
         enable_timer();
-    });
+    }},
 
-    espbase::command("commit", [](std::vector<std::vector<char>>&& args){
+    {"commit", [](auto&){
         timer1_disable();
         espbase::print("commit config notmr\n");
         delay(20);
-        EEPROM.commit();
+        {
+            espbase::profile_scope perf(perf_eeprom_commit);
+            EEPROM.commit();
+        }
         enable_timer();
+    }},
+});
+
+static_assert(espbase::unique_names(commands));
+
+
+void setup() {
+    Serial.begin(8 * 115200);
+    espbase::dbg = &Serial;
+
+    espbase::setup();
+
+    if (config.led_count > NUM_LEDS)
+        config.led_count = NUM_LEDS;
+
+    espbase::on_wifi_connected = []{
+        // snprintf(device_name, sizeof(device_name), "wul-%s", espbase::device_id());
+        // MDNS.begin(device_name);
+        // MDNS.addService("wul-config", "tcp", 1444);
+    };
+
+    ntp.begin(millis());
+
+    espbase::tracer.name(trace_isr_enter, "isr_enter");
+    espbase::tracer.name(trace_isr_exit, "isr_exit");
+    espbase::tracer.name(trace_frame_publish, "frame_publish");
+    espbase::tracer.name(trace_ntp_sync, "ntp_sync");
+    espbase::tracer.name(trace_alarm, "alarm");
+    espbase::tracer.name(trace_idle, "idle");
+    espbase::tracer.name(trace_wake, "wake");
+
+    pinMode(LED_BUILTIN, OUTPUT);
+    config_meta.on_change("builtin_led", []{
+        // shares GPIO2 with the UART backend
+        if (config.led_backend != backend_uart)
+            digitalWrite(LED_BUILTIN, !config.builtin_led);
+    });
+
+    config_meta.on_change("led_brightness", update_gamma);
+    config_meta.on_change("led_gamma", update_gamma);
+    config_meta.on_change("ramp", []{ color_ramp.build(config.ramp); });
+    config_meta.on_change("led_irq_window", []{
+        uint8_t& window = config.led_irq_window.value;
+        if (window != 0x00 && window != 0xff)
+            window = max<unsigned>(min<unsigned>(window, ledstrip::ws2812::latch_us), min_irq_window_us);
     });
+    config_meta.on_change("alarms", update_schedule);
+    config_meta.on_change("duration", update_schedule);
+
+    pinMode(D3, OUTPUT);
+    d3_lo();
+
+    espbase::set_commands(commands);
 
     setup_timer();
+    setup_tasks();
 
     config_meta.notify_all();
 }
 
 
 void loop() {
-    espbase::loop();
-    read_serial();
-
-    // MDNS.update();
-    timeClient.update();
+    uint32_t clk = __clock_cycles();
+    uint64_t now = cycles.update(clk);
 
     {
         static uint32_t clk_prev;
-        auto clk = __clock_cycles();
         loop_interval = clk - clk_prev;
-        t += double(loop_interval) / F_CPU;
         clk_prev = clk;
 
-        if (t > config.duration)
+        if (now - start_cycles > espbase::seconds_to_cycles(config.duration, F_CPU))
             is_running = false;
     }
 
-    if (!is_running) {
-        time_t now = timeClient.getEpochTime();
-        time_t midnight = (now / SECS_PER_DAY) * SECS_PER_DAY;
-
-        time_t morning = midnight + 7 * SECS_PER_HOUR + 30 * SECS_PER_MIN;
-        time_t evening = midnight + 23 * SECS_PER_HOUR + 30 * SECS_PER_MIN;
+    // `on` and alarms only set is_running
+    if (is_running && output_idle)
+        wake_output();
 
-        if ((morning <= now) && (now - morning < config.duration)) {
-            t = now - morning;
-            is_running = true;
-        }
+    tasks.run();
 
-        if ((evening <= now) && (now - evening < config.duration)) {
-            t = now - evening;
-            is_running = true;
-        }
+    // alarms are polled every 100 ms, well within a sleep
+    if (output_idle && !is_running) {
+        uint64_t before = cycles.now();
+        delay(idle_sleep_ms);
+        idle_cycles += cycles.update(__clock_cycles()) - before;
     }
-
-    calc_colors();
 }
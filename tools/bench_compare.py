@@ -0,0 +1,46 @@
+#!/usr/bin/env python3
+"""Compares two runs of the benchmarks in bench/, exits 1 on a regression.
+
+    tools/bench_compare.py before.json after.json [--threshold 10]
+"""
+
+import argparse
+import json
+import sys
+
+
+def load(path):
+    with open(path) as f:
+        return {b['name']: b['ns'] for b in json.load(f)['benchmarks']}
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('before')
+    parser.add_argument('after')
+    parser.add_argument('-t', '--threshold', type=float, default=10,
+                        help='slowdown in %% that counts as a regression (default 10)')
+    args = parser.parse_args()
+
+    before = load(args.before)
+    after = load(args.after)
+    regressions = 0
+
+    print(f'{"benchmark":32} {"before ns":>12} {"after ns":>12} {"change":>8}')
+    for name in sorted(before.keys() | after.keys()):
+        if name not in before or name not in after:
+            print(f'{name:32} {before.get(name, float("nan")):12.1f} {after.get(name, float("nan")):12.1f}')
+            continue
+
+        change = (after[name] / before[name] - 1) * 100
+        regressed = change > args.threshold
+        regressions += regressed
+        print(f'{name:32} {before[name]:12.1f} {after[name]:12.1f} {change:+7.1f}%{"  <--" if regressed else ""}')
+
+    if regressions:
+        print(f'{regressions} regression(s) over {args.threshold:g} %')
+    sys.exit(1 if regressions else 0)
+
+
+if __name__ == '__main__':
+    main()
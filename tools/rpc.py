@@ -0,0 +1,212 @@
+#!/usr/bin/env python3
+"""Reads and writes the light's config over the binary protocol of the config port.
+
+    tools/rpc.py 192.168.2.2 get                      # all members
+    tools/rpc.py 192.168.2.2 get led_brightness ramp
+    tools/rpc.py 192.168.2.2 set led_brightness=0xff hostname=light
+    tools/rpc.py 192.168.2.2 dump > light.json        # all members as JSON
+    tools/rpc.py 192.168.2.2 sync light.json          # write them back, one round trip
+    tools/rpc.py 192.168.2.2 command t0 120
+
+The framing and the opcodes are described in lib/espbase/src/rpc.hpp.
+Values are hex (0x...) as in the config command; set also takes text,
+zero padded by the light.
+"""
+
+import argparse
+import json
+import socket
+import struct
+import sys
+
+MAGIC = 0xb1
+OP_GET, OP_SET, OP_COMMAND, OP_ERROR, OP_REPLY = 0x01, 0x02, 0x03, 0x7f, 0x80
+
+STATUS = ['ok', 'unknown', 'bad size', 'bad crc', 'bad length', 'bad opcode', 'bad payload', 'too large']
+
+# value types in get replies, the kind | the element size
+TYPE_UINT, TYPE_INT, TYPE_TEXT, TYPE_BOOL = 0x00, 0x10, 0x20, 0x30
+
+
+def crc16(data, crc=0):
+    # CCITT, same as lib/ecg-serial/src/crc.h
+    for byte in data:
+        crc ^= byte << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021 if crc & 0x8000 else crc << 1) & 0xffff
+    return crc
+
+
+def frame(opcode, payload=b''):
+    body = struct.pack('<HB', 1 + len(payload), opcode) + payload
+    return bytes([MAGIC]) + body + struct.pack('<H', crc16(body))
+
+
+class Connection:
+    def __init__(self, host, port):
+        self.sock = socket.create_connection((host, port), timeout=5)
+        self.buffer = b''
+
+    def send(self, *frames):
+        # all at once, the replies come back in order
+        self.sock.sendall(b''.join(frames))
+
+    def read(self, size):
+        while len(self.buffer) < size:
+            data = self.sock.recv(4096)
+            if not data:
+                raise EOFError('connection closed')
+            self.buffer += data
+        data, self.buffer = self.buffer[:size], self.buffer[size:]
+        return data
+
+    def reply(self, opcode):
+        while self.read(1)[0] != MAGIC:
+            pass
+        header = self.read(3)
+        length, reply_opcode = struct.unpack('<HB', header)
+        payload = self.read(length - 1)
+        crc, = struct.unpack('<H', self.read(2))
+
+        if crc != crc16(header + payload):
+            raise IOError('reply with a bad CRC')
+        if reply_opcode == OP_ERROR | OP_REPLY:
+            raise IOError(f'request failed: {status(payload[0])}')
+        if reply_opcode != opcode | OP_REPLY:
+            raise IOError(f'unexpected reply {reply_opcode:#x}')
+        return payload
+
+
+def status(code):
+    return STATUS[code] if code < len(STATUS) else f'status {code}'
+
+
+def cstr(name):
+    return name.encode() + b'\0'
+
+
+def split_cstr(payload, at):
+    end = payload.index(b'\0', at)
+    return payload[at:end].decode(errors='replace'), end + 1
+
+
+def get_request(names=()):
+    return frame(OP_GET, b''.join(cstr(n) for n in names))
+
+
+def parse_get(payload):
+    # name: (type, value), value None for unknown members
+    values, at = {}, 0
+    while at < len(payload):
+        name, at = split_cstr(payload, at)
+        type_, size = struct.unpack_from('<BH', payload, at)
+        at += 3
+        values[name] = (type_, payload[at:at + size] if size else None)
+        at += size
+    return values
+
+
+def set_request(values):
+    return frame(OP_SET, b''.join(cstr(n) + struct.pack('<H', len(v)) + v for n, v in values.items()))
+
+
+def command_request(name, args):
+    payload = cstr(name) + bytes([len(args)])
+    for arg in args:
+        payload += struct.pack('<H', len(arg)) + arg
+    return frame(OP_COMMAND, payload)
+
+
+def parse_value(text):
+    if text[:2] in ('0x', '0X'):
+        return bytes.fromhex(text[2:])
+    return text.encode()
+
+
+def decode(type_, value):
+    """The member's value as Python sees it: str, bool, int or a list of ints."""
+    kind, size = type_ & 0xf0, type_ & 0x0f
+    if kind == TYPE_TEXT:
+        return value.split(b'\0')[0].decode(errors='replace')
+    if kind == TYPE_BOOL:
+        return value != b'\0'
+    if not size or len(value) % size:
+        return value
+    items = [int.from_bytes(value[i:i + size], 'big', signed=kind == TYPE_INT) for i in range(0, len(value), size)]
+    return items[0] if len(items) == 1 else items
+
+
+def format_value(type_, value):
+    if value is None:
+        return '(unknown)'
+    if type_ & 0xf0 in (TYPE_UINT, TYPE_INT):
+        return f'{decode(type_, value)} (0x{value.hex()})'
+    return repr(decode(type_, value))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('host', help='address of the light')
+    parser.add_argument('-p', '--port', type=int, default=8266, help='config port (default 8266)')
+    sub = parser.add_subparsers(dest='action', required=True)
+    sub.add_parser('get').add_argument('names', nargs='*')
+    sub.add_parser('set').add_argument('values', nargs='+', metavar='name=value')
+    sub.add_parser('dump')
+    sub.add_parser('sync').add_argument('file', help='JSON from dump, - for stdin')
+    command = sub.add_parser('command')
+    command.add_argument('name')
+    command.add_argument('args', nargs='*')
+    args = parser.parse_args()
+
+    conn = Connection(args.host, args.port)
+
+    if args.action == 'get':
+        conn.send(get_request(args.names))
+        for name, (type_, value) in parse_get(conn.reply(OP_GET)).items():
+            print(f'{name} {format_value(type_, value)}')
+
+    elif args.action == 'dump':
+        conn.send(get_request())
+        values = parse_get(conn.reply(OP_GET))
+        json.dump({n: '0x' + v.hex() for n, (_, v) in values.items()}, sys.stdout, indent=4)
+        print()
+
+    elif args.action in ('set', 'sync'):
+        if args.action == 'set':
+            values = dict(v.split('=', 1) for v in args.values)
+        else:
+            f = sys.stdin if args.file == '-' else open(args.file)
+            values = json.load(f)
+        values = {n: parse_value(v) for n, v in values.items()}
+
+        # the read back goes along, one round trip for both
+        conn.send(set_request(values), get_request(values))
+        results = conn.reply(OP_SET)
+        current = parse_get(conn.reply(OP_GET))
+
+        failed = 0
+        for (name, value), result in zip(values.items(), results):
+            if result:
+                failed += 1
+                print(f'{name}: {status(result)}', file=sys.stderr)
+            else:
+                # as the light pads it, compared by type: a bool reads back as 0 or 1
+                type_, read = current[name]
+                if decode(type_, read) != decode(type_, value.ljust(len(read), b'\0')):
+                    failed += 1
+                    print(f'{name}: reads back as {format_value(type_, read)}', file=sys.stderr)
+        print(f'{len(values) - failed} of {len(values)} set')
+        sys.exit(1 if failed else 0)
+
+    elif args.action == 'command':
+        conn.send(command_request(args.name, [parse_value(a) for a in args.args]))
+        payload = conn.reply(OP_COMMAND)
+        result, size = struct.unpack_from('<BH', payload)
+        sys.stdout.buffer.write(payload[3:3 + size])
+        if result:
+            print(f'{args.name}: {status(result)}', file=sys.stderr)
+            sys.exit(1)
+
+
+if __name__ == '__main__':
+    main()
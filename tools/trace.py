@@ -0,0 +1,135 @@
+#!/usr/bin/env python3
+"""Fetches the event trace from the light and prints it as a timeline.
+
+    tools/trace.py 192.168.2.2            # sends `trace` to the config port
+    tools/trace.py -f dump.bin            # a saved dump, or - for stdin
+
+The dump format is described in lib/espbase/src/trace.hpp. Anything before
+the magic, like the command echo, is skipped.
+"""
+
+import argparse
+import socket
+import struct
+import sys
+
+MAGIC = b'TRC1'
+HEADER = struct.Struct('<4sIIIHH')
+ENTRY = struct.Struct('<IBxH')
+
+TRACE_COMMAND = 0
+
+
+class Reader:
+    def __init__(self, read):
+        self.read_some = read
+        self.buffer = b''
+
+    def read(self, size):
+        while len(self.buffer) < size:
+            data = self.read_some(4096)
+            if not data:
+                raise EOFError('dump truncated')
+            self.buffer += data
+        data, self.buffer = self.buffer[:size], self.buffer[size:]
+        return data
+
+    def string(self):
+        while b'\0' not in self.buffer:
+            data = self.read_some(4096)
+            if not data:
+                raise EOFError('dump truncated')
+            self.buffer += data
+        data, _, self.buffer = self.buffer.partition(b'\0')
+        return data.decode(errors='replace')
+
+    def skip_to(self, magic):
+        while magic not in self.buffer:
+            data = self.read_some(4096)
+            if not data:
+                raise EOFError('no trace in the output')
+            # keep a possible partial magic
+            self.buffer = self.buffer[-len(magic):] + data
+        self.buffer = self.buffer[self.buffer.index(magic):]
+
+
+def parse(reader):
+    reader.skip_to(MAGIC)
+    _, cpu_hz, count, lost, name_count, label_count = HEADER.unpack(reader.read(HEADER.size))
+
+    names = {}
+    for _ in range(name_count):
+        event = reader.read(1)[0]
+        names[event] = reader.string()
+
+    labels = {}
+    for _ in range(label_count):
+        event, arg = struct.unpack('<BH', reader.read(3))
+        labels[event, arg] = reader.string()
+
+    entries = [ENTRY.unpack(reader.read(ENTRY.size)) for _ in range(count)]
+    return cpu_hz, lost, names, labels, entries
+
+
+def timeline(cpu_hz, lost, names, labels, entries, out=sys.stdout):
+    if lost:
+        print(f'# {lost} events lost (ring full or dumping)', file=out)
+    if not entries:
+        print('# empty', file=out)
+        return
+
+    # cycles wrap every 2^32 / cpu_hz s, a gap that long between two events is not expected
+    t = 0
+    prev = entries[0][0]
+    print(f'# {len(entries)} events, {cpu_hz / 1e6:g} MHz', file=out)
+    print(f'{"time us":>12} {"delta us":>10}  event', file=out)
+
+    for cycles, event, arg in entries:
+        delta = (cycles - prev) & 0xffffffff
+        t += delta
+        prev = cycles
+
+        name = names.get(event, f'event {event}')
+        label = labels.get((event, arg))
+        detail = label if label is not None else (str(arg) if arg else '')
+        print(f'{t * 1e6 / cpu_hz:12.1f} {delta * 1e6 / cpu_hz:10.1f}  {name} {detail}'.rstrip(), file=out)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('host', nargs='?', help='address of the light')
+    parser.add_argument('-p', '--port', type=int, default=8266, help='config port (default 8266)')
+    parser.add_argument('-f', '--file', help='read a saved dump instead, - for stdin')
+    parser.add_argument('-o', '--output', help='also save the raw dump here')
+    args = parser.parse_args()
+
+    if bool(args.host) == bool(args.file):
+        parser.error('give either a host or --file')
+
+    raw = []
+
+    if args.file:
+        f = sys.stdin.buffer if args.file == '-' else open(args.file, 'rb')
+        read = f.read
+    else:
+        sock = socket.create_connection((args.host, args.port), timeout=5)
+        sock.sendall(b'trace\n')
+        read = sock.recv
+
+    def recording(size):
+        data = read(size)
+        raw.append(data)
+        return data
+
+    try:
+        result = parse(Reader(recording))
+    finally:
+        if args.output:
+            with open(args.output, 'wb') as f:
+                f.write(b''.join(raw))
+
+    timeline(*result)
+
+
+if __name__ == '__main__':
+    main()